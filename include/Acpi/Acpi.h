@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace cosmo
+{
+/*!
+ * \namespace acpi
+ * \brief Read-only access to the ACPI firmware tables.
+ */
+namespace acpi
+{
+    constexpr size_t kMaxIoApics = 4;  /*!< Max IO-APICs recorded from the MADT. */
+    constexpr size_t kNumIsaIrqs = 16; /*!< Number of legacy ISA IRQs. */
+
+    /*!
+     * This enum aliases the MPS INTI flags of an interrupt source override.
+     */
+    enum IntiFlags : uint16_t
+    {
+        kIntiPolarityMask = 0x0003, /*!< Polarity field. */
+        kIntiActiveHigh   = 0x0001, /*!< Active high. */
+        kIntiActiveLow    = 0x0003, /*!< Active low. */
+        kIntiTriggerMask  = 0x000C, /*!< Trigger mode field. */
+        kIntiEdge         = 0x0004, /*!< Edge triggered. */
+        kIntiLevel        = 0x000C  /*!< Level triggered. */
+    }; // end IntiFlags
+
+    /*!
+     * \struct IoApicInfo
+     * \brief An IO-APIC listed in the MADT.
+     */
+    struct IoApicInfo
+    {
+        uint8_t  id;       /*!< IO-APIC ID. */
+        uint32_t phys;     /*!< Physical address of the registers. */
+        uint32_t gsi_base; /*!< Global system interrupt of the first pin. */
+    }; // end IoApicInfo
+
+    /*!
+     * \struct MadtInfo
+     * \brief Interrupt controller routing described by the MADT.
+     */
+    struct MadtInfo
+    {
+        uint32_t   lapic_phys;                /*!< Physical address of the local APIC. */
+        bool       pcat_compat;               /*!< 8259 PICs are installed too. */
+        size_t     num_io_apics;              /*!< Entries used in io_apics. */
+        IoApicInfo io_apics[kMaxIoApics];     /*!< IO-APICs. */
+        uint32_t   isa_gsi[kNumIsaIrqs];      /*!< GSI each ISA IRQ is wired to. */
+        uint16_t   isa_flags[kNumIsaIrqs];    /*!< #IntiFlags of each ISA IRQ, 0 for bus default. */
+    }; // end MadtInfo
+
+    /*!
+     * \brief Locate the MADT through the RSDP and RSDT and decode it into
+     *        \a info.
+     *
+     * The RSDP is searched for in the first KiB of the EBDA and in the BIOS
+     * area below 1 MiB. Every table's checksum is verified. ISA IRQs without
+     * an interrupt source override are identity mapped to their GSI. Tables
+     * beyond the physmap are mapped with VirtualMemoryManager::MapIo() and
+     * unmapped again before returning, so this must run after
+     * PhysicalFrameAllocator::Init().
+     *
+     * \return \c false if there is no valid RSDP, RSDT or MADT.
+     */
+    bool ParseMadt(MadtInfo* info);
+} // end acpi
+} // end cosmo
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Acpi.h"
+
+namespace cosmo
+{
+/*!
+ * \namespace apic
+ * \brief Local APIC and IO-APIC configuration functions.
+ *
+ * The IO-APICs deliver IRQ lines to the local APIC of the boot CPU. Lines
+ * 0-15 are the ISA IRQs, routed to the GSIs the MADT interrupt source
+ * overrides name. Lines 16 to #kNumLines - 1 are GSIs 16 and up, the PCI
+ * interrupt pins. IRQ line \c n raises vector #kIrqVectorBase + \c n, the
+ * same vectors the remapped 8259 PICs use for lines 0-15.
+ *
+ * The registers are accessed through VirtualMemoryManager::MapIo()
+ * mappings. The mask bit of every redirection entry is shadowed, so
+ * SetMask() and ClearMask() are a single MMIO register write and SendEOI()
+ * is a single store to the local APIC.
+ */
+namespace apic
+{
+    constexpr uint8_t kIrqVectorBase  = 0x20; /*!< Vector of IRQ line 0. */
+    constexpr uint8_t kNumLines       = 24;   /*!< IRQ lines routed. */
+    constexpr uint8_t kSpuriousVector = 0xFF; /*!< Local APIC spurious vector. */
+
+    /*!
+     * \brief Return \c true if CPUID reports an on-chip local APIC.
+     */
+    bool IsSupported();
+
+    /*!
+     * \brief Enable the local APIC and program the IO-APICs from \a madt.
+     *
+     * Every redirection entry starts out masked. LINT0, through which the
+     * 8259 PICs deliver their interrupts in virtual wire mode, is masked as
+     * well. Must run with interrupts disabled, after
+     * PhysicalFrameAllocator::Init().
+     *
+     * \return \c false if the registers could not be mapped. The APICs are
+     *         left untouched in that case.
+     */
+    bool Init(const acpi::MadtInfo& madt);
+
+    /*!
+     * \brief Return \c true if IRQ line \a irq_line is wired to an IO-APIC
+     *        pin.
+     */
+    bool IsRoutable(uint8_t irq_line);
+
+    /*!
+     * \brief Signal the end of the interrupt being serviced to the local
+     *        APIC.
+     */
+    void SendEOI();
+
+    /*!
+     * \brief Mask IRQ line \a irq_line at its IO-APIC.
+     */
+    void SetMask(uint8_t irq_line);
+
+    /*!
+     * \brief Clear the mask of IRQ line \a irq_line at its IO-APIC.
+     */
+    void ClearMask(uint8_t irq_line);
+} // end apic
+} // end cosmo
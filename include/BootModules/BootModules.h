@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "multiboot.h"
+
+namespace cosmo
+{
+/*!
+ * \namespace boot
+ * \brief Access to data handed over by the bootloader.
+ */
+namespace boot
+{
+/*!
+ * \struct BootModule
+ * \brief A Multiboot module loaded by GRUB.
+ */
+struct BootModule
+{
+    uint32_t    phys_start; /*!< Physical address of the first byte. */
+    uint32_t    phys_end;   /*!< Physical address past the last byte. */
+    const char* cmdline;    /*!< Module command line, empty if none. */
+    const void* data;       /*!< Read-only mapping, nullptr until Map(). */
+}; // end BootModule
+
+/*!
+ * \class BootModules
+ * \brief Zero-copy access to the Multiboot modules (e.g. an initrd).
+ *
+ * PhysicalFrameAllocator::Init() keeps the module frames in use, so the
+ * modules stay where GRUB loaded them. Map() maps a module read-only into
+ * the module window at #kWindowBase, without copying it. Each mapping is
+ * followed by an unmapped guard page that catches reads past the module.
+ *
+ * The command lines are read in place through the physmap. This is a
+ * singleton class whose Init() function must be called after
+ * PhysicalFrameAllocator::Init().
+ */
+class BootModules
+{
+public:
+    static const size_t   kMaxModules = 16;         /*!< Max modules tracked. */
+    static const uint32_t kWindowBase = 0xF8000000; /*!< Start of the module window. */
+    static const uint32_t kWindowSize = 0x04000000; /*!< Size of the module window. */
+
+    ~BootModules() = default;
+
+    /* Disable copy construction and copy assignment. */
+    BootModules(const BootModules&) = delete;
+    BootModules& operator=(const BootModules&) = delete;
+
+    /* Disable move construction and move assignment. */
+    BootModules(BootModules&&) = delete;
+    BootModules& operator=(BootModules&&) = delete;
+
+    /*!
+     * \brief Return the singleton instance of BootModules.
+     */
+    static BootModules& GetInstance();
+
+    /*!
+     * \brief Record the modules listed in \a mb_info.
+     *
+     * Modules past #kMaxModules are ignored.
+     */
+    void Init(const multiboot_info_t* mb_info);
+
+    /*!
+     * \brief Return the number of modules.
+     */
+    size_t GetCount() const { return count_; }
+
+    /*!
+     * \brief Return module \a index or nullptr if out of range.
+     */
+    const BootModule* GetModule(size_t index) const;
+
+    /*!
+     * \brief Return the index of the first module whose command line starts
+     *        with \a name, or -1 if there is none.
+     *
+     * GRUB passes the text following the module path as its command line,
+     * e.g. "initrd" for "module /boot/initrd.tar initrd".
+     */
+    int FindModule(const char* name) const;
+
+    /*!
+     * \brief Map module \a index read-only and return its address.
+     *
+     * Mapping an already mapped module returns the existing mapping.
+     *
+     * \return The module data or nullptr if \a index is out of range, the
+     *         window is full or the mapping failed.
+     */
+    const void* Map(size_t index);
+
+private:
+    BootModules() : count_(0), window_next_(kWindowBase) { }
+
+    BootModule modules_[kMaxModules]; /*!< Recorded modules. */
+    size_t     count_;                /*!< Number of recorded modules. */
+    uint32_t   window_next_;          /*!< Next free address in the window. */
+}; // end BootModules
+} // end boot
+} // end cosmo
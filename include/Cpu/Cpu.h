@@ -0,0 +1,246 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace cosmo
+{
+/*!
+ * \namespace cpu
+ * \brief Thin inline wrappers around privileged x86 instructions.
+ */
+namespace cpu
+{
+constexpr uint32_t kEflagsIf = 1 << 9; /*!< EFLAGS interrupt enable flag. */
+
+constexpr uint32_t kCpuidFeatureLeaf = 0x01;    /*!< CPUID processor feature leaf. */
+constexpr uint32_t kCpuidEdxApic     = 1 << 9;  /*!< CPUID.01h:EDX on-chip local APIC. */
+constexpr uint32_t kCpuidEdxPge      = 1 << 13; /*!< CPUID.01h:EDX global page support. */
+constexpr uint32_t kCpuidEdxSse2     = 1 << 26; /*!< CPUID.01h:EDX SSE2 support. */
+constexpr uint32_t kCr0Wp            = 1 << 16; /*!< CR0 write protect in ring 0. */
+constexpr uint32_t kCr4Pge           = 1 << 7;  /*!< CR4 global page enable. */
+constexpr uint32_t kMsrApicBase      = 0x1B;    /*!< IA32_APIC_BASE MSR. */
+
+/*!
+ * \struct CpuidRegs
+ * \brief Register values returned by the CPUID instruction.
+ */
+struct CpuidRegs
+{
+    uint32_t eax; /*!< EAX output. */
+    uint32_t ebx; /*!< EBX output. */
+    uint32_t ecx; /*!< ECX output. */
+    uint32_t edx; /*!< EDX output. */
+}; // end CpuidRegs
+
+/*!
+ * \brief Execute CPUID for \a leaf and return the resulting registers.
+ */
+inline CpuidRegs Cpuid(uint32_t leaf)
+{
+    CpuidRegs regs;
+    __asm__ volatile("cpuid"
+                     : "=a"(regs.eax), "=b"(regs.ebx),
+                       "=c"(regs.ecx), "=d"(regs.edx)
+                     : "a"(leaf), "c"(0));
+    return regs;
+}
+
+/*!
+ * \brief Invalidate the TLB entry that maps virtual address \a addr.
+ */
+inline void Invlpg(uint32_t addr)
+{
+    __asm__ volatile("invlpg (%0)" : : "r"(addr) : "memory");
+}
+
+/*!
+ * \brief Return the time stamp counter.
+ */
+inline uint64_t ReadTsc()
+{
+    uint32_t low  = 0;
+    uint32_t high = 0;
+    __asm__ volatile("rdtsc" : "=a"(low), "=d"(high));
+    return (static_cast<uint64_t>(high) << 32) | low;
+}
+
+/*!
+ * \brief Return the value of the model specific register \a msr.
+ */
+inline uint64_t ReadMsr(uint32_t msr)
+{
+    uint32_t low  = 0;
+    uint32_t high = 0;
+    __asm__ volatile("rdmsr" : "=a"(low), "=d"(high) : "c"(msr));
+    return (static_cast<uint64_t>(high) << 32) | low;
+}
+
+/*!
+ * \brief Write \a value to the model specific register \a msr.
+ */
+inline void WriteMsr(uint32_t msr, uint64_t value)
+{
+    __asm__ volatile("wrmsr"
+                     :
+                     : "c"(msr), "a"(static_cast<uint32_t>(value)),
+                       "d"(static_cast<uint32_t>(value >> 32))
+                     : "memory");
+}
+
+/*!
+ * \brief Return the value of CR0.
+ */
+inline uint32_t ReadCr0()
+{
+    uint32_t cr0 = 0;
+    __asm__ volatile("mov %%cr0, %0" : "=r"(cr0));
+    return cr0;
+}
+
+/*!
+ * \brief Load \a cr0 into CR0.
+ */
+inline void WriteCr0(uint32_t cr0)
+{
+    __asm__ volatile("mov %0, %%cr0" : : "r"(cr0) : "memory");
+}
+
+/*!
+ * \brief Return the value of CR3 (physical address of the page directory).
+ */
+inline uint32_t ReadCr3()
+{
+    uint32_t cr3 = 0;
+    __asm__ volatile("mov %%cr3, %0" : "=r"(cr3));
+    return cr3;
+}
+
+/*!
+ * \brief Load \a cr3 into CR3, flushing all non-global TLB entries.
+ */
+inline void WriteCr3(uint32_t cr3)
+{
+    __asm__ volatile("mov %0, %%cr3" : : "r"(cr3) : "memory");
+}
+
+/*!
+ * \brief Flush all non-global TLB entries.
+ */
+inline void FlushTlb()
+{
+    WriteCr3(ReadCr3());
+}
+
+/*!
+ * \brief Return the value of CR4.
+ */
+inline uint32_t ReadCr4()
+{
+    uint32_t cr4 = 0;
+    __asm__ volatile("mov %%cr4, %0" : "=r"(cr4));
+    return cr4;
+}
+
+/*!
+ * \brief Load \a cr4 into CR4.
+ */
+inline void WriteCr4(uint32_t cr4)
+{
+    __asm__ volatile("mov %0, %%cr4" : : "r"(cr4) : "memory");
+}
+
+/*!
+ * \brief Flush all TLB entries, including global ones.
+ *
+ * Toggling CR4.PGE invalidates the global entries as well. Without global
+ * pages a CR3 reload already flushes everything.
+ */
+inline void FlushTlbGlobal()
+{
+    uint32_t cr4 = ReadCr4();
+    if (cr4 & kCr4Pge) {
+        WriteCr4(cr4 & ~kCr4Pge);
+        WriteCr4(cr4);
+    } else {
+        FlushTlb();
+    }
+}
+
+/*!
+ * \brief Return the current EFLAGS value.
+ */
+inline uint32_t ReadEflags()
+{
+    uint32_t eflags = 0;
+    __asm__ volatile("pushf\n\t"
+                     "pop %0"
+                     : "=r"(eflags)
+                     :
+                     : "memory");
+    return eflags;
+}
+
+/*!
+ * \brief Set the interrupt flag.
+ */
+inline void EnableInterrupts()
+{
+    __asm__ volatile("sti" ::: "memory");
+}
+
+/*!
+ * \brief Clear the interrupt flag.
+ */
+inline void DisableInterrupts()
+{
+    __asm__ volatile("cli" ::: "memory");
+}
+
+/*!
+ * \brief Disable interrupts and return the previous EFLAGS value.
+ */
+inline uint32_t SaveAndDisableInterrupts()
+{
+    uint32_t eflags = ReadEflags();
+    __asm__ volatile("cli" ::: "memory");
+    return eflags;
+}
+
+/*!
+ * \brief Re-enable interrupts if they were enabled in \a eflags.
+ *
+ * \param eflags Value returned by a preceding SaveAndDisableInterrupts().
+ */
+inline void RestoreInterrupts(uint32_t eflags)
+{
+    if (eflags & kEflagsIf)
+        __asm__ volatile("sti" ::: "memory");
+}
+
+/*!
+ * \class InterruptGuard
+ * \brief Disable interrupts for the lifetime of the guard.
+ *
+ * The interrupt flag is restored to its previous state on destruction, so
+ * guards may be nested and used from code that already runs with interrupts
+ * disabled.
+ */
+class InterruptGuard
+{
+public:
+    InterruptGuard() : eflags_(SaveAndDisableInterrupts()) { }
+    ~InterruptGuard() { RestoreInterrupts(eflags_); }
+
+    /* Disable copy construction and copy assignment. */
+    InterruptGuard(const InterruptGuard&) = delete;
+    InterruptGuard& operator=(const InterruptGuard&) = delete;
+
+    /* Disable move construction and move assignment. */
+    InterruptGuard(InterruptGuard&&) = delete;
+    InterruptGuard& operator=(InterruptGuard&&) = delete;
+
+private:
+    uint32_t eflags_; /*!< EFLAGS at construction. */
+}; // end InterruptGuard
+} // end cpu
+} // end cosmo
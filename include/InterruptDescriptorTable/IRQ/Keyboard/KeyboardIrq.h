@@ -8,8 +8,64 @@ namespace interrupt
 {
 namespace irq
 {
+/*!
+ * \namespace kbd
+ * \brief PS/2 keyboard driver.
+ *
+ * The driver works in three stages:
+ *   1. HandleIrq() reads the scan code and pushes it onto a ring of
+ *      #kScanCodeSlots raw scan codes.
+ *   2. A SoftIrq work item decodes the scan codes. It tracks the modifier
+ *      keys and turns every make and break code into a KeyEvent on a ring
+ *      of #kEventSlots events.
+ *   3. A single consumer reads the events with PollEvent() or WaitEvent().
+ *
+ * Both rings are single producer, single consumer RingBuffers. A ring that
+ * runs full drops the newest entry. The drops and the highest fill level of
+ * each ring are reported by GetStats().
+ */
 namespace kbd
 {
+    static const uint32_t kScanCodeSlots = 64; /*!< Raw scan code ring size. */
+    static const uint32_t kEventSlots    = 64; /*!< KeyEvent ring size. */
+
+    /*!
+     * \enum Modifier
+     * \brief Bits of KeyEvent::modifiers.
+     */
+    enum Modifier : uint8_t
+    {
+        kModShift    = 1 << 0, /*!< Either shift key is held. */
+        kModCtrl     = 1 << 1, /*!< Either control key is held. */
+        kModAlt      = 1 << 2, /*!< Either alt key is held. */
+        kModCapsLock = 1 << 3  /*!< Caps lock is on. */
+    }; // end Modifier
+
+    /*!
+     * \struct KeyEvent
+     * \brief A key press or release.
+     */
+    struct KeyEvent
+    {
+        uint8_t scan_code; /*!< Scan code set 1 make code of the key. */
+        uint8_t modifiers; /*!< Modifier bits after the event. */
+        char    ascii;     /*!< Character of the key in the US layout or 0. */
+        bool    pressed;   /*!< \c true on press, \c false on release. */
+        bool    extended;  /*!< The key sent the 0xE0 prefix. */
+    }; // end KeyEvent
+
+    /*!
+     * \struct KbdStats
+     * \brief Ring statistics for sizing #kScanCodeSlots and #kEventSlots.
+     */
+    struct KbdStats
+    {
+        uint32_t scan_codes_dropped;   /*!< Scan codes lost on a full ring. */
+        uint32_t scan_code_high_water; /*!< Most scan codes queued at once. */
+        uint32_t events_dropped;       /*!< Events lost on a full ring. */
+        uint32_t event_high_water;     /*!< Most events queued at once. */
+    }; // end KbdStats
+
     /*!
      * \brief Read a keyboard scan code.
      *
@@ -18,11 +74,44 @@ namespace kbd
     uint8_t ReadScanCode();
 
     /*!
-     * \brief Print the ASCII character referred to by \a scan_code to screen.
+     * \brief Keyboard IRQ handler, queues the scan code for decoding.
+     *
+     * \param context Unused.
+     *
+     * \return Always \c true, the keyboard line is not shared.
+     */
+    bool HandleIrq(void* context);
+
+    /*!
+     * \brief Register HandleIrq() on the keyboard IRQ line.
      *
-     * \param scan_code A KBD scan code read via a call to ReadScanCode().
+     * \return \c true on success.
+     */
+    bool Init();
+
+    /*!
+     * \brief Take the oldest key event into \a event without waiting.
+     *
+     * \return \c false if no event is queued.
+     */
+    bool PollEvent(KeyEvent* event);
+
+    /*!
+     * \brief Return \c true if key events are waiting for the consumer.
+     */
+    bool HasEvents();
+
+    /*!
+     * \brief Return the oldest key event, halting until one arrives.
+     *
+     * Must be called with interrupts enabled.
+     */
+    KeyEvent WaitEvent();
+
+    /*!
+     * \brief Return the drop counters and high water marks of the rings.
      */
-    void PrintAsciiChar(uint8_t scan_code);
+    KbdStats GetStats();
 } // end kbd
 } // end irq
 } // end interrupt
@@ -94,7 +94,8 @@ private:
      * \brief Construct an IDT with entries 0-31 pre-populated.
      *
      * InterruptDescriptorTable() registers the 32 Intel mandated CPU exception
-     * handlers as well as 16 default IRQ handlers.
+     * handlers as well as 24 IRQ handlers and the local APIC spurious
+     * vector.
      */
     InterruptDescriptorTable();
 
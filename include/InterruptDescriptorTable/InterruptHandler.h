@@ -36,6 +36,15 @@ enum Irq
     kIdeBus2
 }; // end Irq
 
+/*!
+ * \enum Exception
+ * \brief CPU exception vectors with a dedicated handler path.
+ */
+enum Exception
+{
+    kPageFault = 14
+}; // end Exception
+
 /*!
  * \struct InterruptContext
  * \brief This struct stores the CPU register context.
@@ -106,10 +115,13 @@ extern "C" void isr31();
 /*!
  * \brief Hardware interrupt handler routine.
  *
- * irq_handler() dispatches the appropriate IRQ handler depending on the
- * IRQ that is detected.
+ * irq_handler() passes the IRQ on to IrqDispatcher::Dispatch(), which runs
+ * the handlers registered for the line. IRQs enter through a lean stub that
+ * saves no InterruptContext, see InterruptHandler.nasm.
+ *
+ * \param irq IRQ line that fired.
  */
-extern "C" void irq_handler(struct InterruptContext* int_context);
+extern "C" void irq_handler(uint32_t irq);
 
 /* Pointers to the IRQs generated by the macros in InterruptHandler.nasm. */
 extern "C" void irq0();
@@ -128,5 +140,40 @@ extern "C" void irq12();
 extern "C" void irq13();
 extern "C" void irq14();
 extern "C" void irq15();
+extern "C" void irq16();
+extern "C" void irq17();
+extern "C" void irq18();
+extern "C" void irq19();
+extern "C" void irq20();
+extern "C" void irq21();
+extern "C" void irq22();
+extern "C" void irq23();
+
+/*!
+ * \brief Entry of the local APIC spurious vector.
+ *
+ * Only counts the interrupt in #apic_spurious_count. A spurious interrupt
+ * must not be acknowledged.
+ */
+extern "C" void apic_spurious();
+
+/*! Number of local APIC spurious interrupts, see IrqChip::GetApicSpurious(). */
+extern "C" uint32_t apic_spurious_count;
+
+#ifdef COSMO_IRQ_BENCH
+/*!
+ * \brief Compare the cycle cost of the exception and IRQ entry paths.
+ *
+ * Installs the benchmark stubs on two free vectors, enters each of them a
+ * number of times with a software interrupt and logs the average cycles per
+ * round trip. Only built with COSMO_IRQ_BENCH.
+ */
+void RunIrqBench();
+
+/* Benchmark entry stubs and the empty handler they call. */
+extern "C" void irq_bench_full();
+extern "C" void irq_bench_lean();
+extern "C" void irq_bench_handler(uint32_t arg);
+#endif
 } // end interrupt
 } // end cosmo
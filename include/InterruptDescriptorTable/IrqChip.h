@@ -0,0 +1,109 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace cosmo
+{
+namespace interrupt
+{
+/*!
+ * \class IrqChip
+ * \brief The interrupt controller that delivers the IRQ lines.
+ *
+ * IrqChip hides whether the IRQs come from the 8259 PICs or the APIC. The
+ * PICs are in use from boot on. UseApic() switches to the local APIC and
+ * IO-APICs if CPUID reports an APIC and the ACPI MADT describes the IO-APIC
+ * routing, otherwise the PICs stay in use. Lines unmasked before the switch
+ * stay unmasked after it.
+ *
+ * Both controllers raise vector 0x20 + \c n for IRQ line \c n. The PICs
+ * deliver lines 0-15, the APIC lines 0 to #kMaxLines - 1. Lines 16 and up
+ * are the PCI interrupt pins.
+ *
+ * Mask(), Unmask() and SendEOI() must be called with interrupts disabled.
+ * This is a singleton class.
+ */
+class IrqChip
+{
+public:
+    static const uint8_t kMaxLines = 24; /*!< IRQ lines of the largest controller. */
+
+    /*!
+     * \enum Type
+     * \brief The interrupt controller in use.
+     */
+    enum class Type
+    {
+        kPic, /*!< 8259 PIC pair. */
+        kApic /*!< Local APIC and IO-APICs. */
+    }; // end Type
+
+    ~IrqChip() = default;
+
+    /* Disable copy construction and copy assignment. */
+    IrqChip(const IrqChip&) = delete;
+    IrqChip& operator=(const IrqChip&) = delete;
+
+    /* Disable move construction and move assignment. */
+    IrqChip(IrqChip&&) = delete;
+    IrqChip& operator=(IrqChip&&) = delete;
+
+    /*!
+     * \brief Return the singleton instance of IrqChip.
+     */
+    static IrqChip& GetInstance();
+
+    /*!
+     * \brief Switch from the PICs to the APIC if the machine has one.
+     *
+     * Must run after PhysicalFrameAllocator::Init(), the APIC registers and
+     * the ACPI tables are mapped with VirtualMemoryManager::MapIo().
+     *
+     * \return \c true if the APIC is in use.
+     */
+    bool UseApic();
+
+    /*!
+     * \brief Return the interrupt controller in use.
+     */
+    Type GetType() const { return type_; }
+
+    /*!
+     * \brief Mask IRQ line \a irq.
+     */
+    void Mask(uint8_t irq);
+
+    /*!
+     * \brief Unmask IRQ line \a irq.
+     *
+     * Lines the controller in use does not deliver are remembered and
+     * unmasked by a later switch to the APIC.
+     */
+    void Unmask(uint8_t irq);
+
+    /*!
+     * \brief Acknowledge the interrupt of IRQ line \a irq.
+     */
+    void SendEOI(uint8_t irq);
+
+    /*!
+     * \brief Return \c true if IRQ line \a irq raised a spurious interrupt.
+     *
+     * The PICs report spurious interrupts on IRQ 7 or 15. The APIC uses a
+     * vector of its own instead, see GetApicSpurious().
+     */
+    bool IsSpurious(uint8_t irq);
+
+    /*!
+     * \brief Return the number of spurious interrupts of the local APIC.
+     */
+    uint32_t GetApicSpurious() const;
+
+private:
+    IrqChip() : type_(Type::kPic), unmasked_(0) { }
+
+    Type     type_;     /*!< Controller in use. */
+    uint32_t unmasked_; /*!< Bit per unmasked IRQ line. */
+}; // end IrqChip
+} // end interrupt
+} // end cosmo
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "IrqChip.h"
+
+namespace cosmo
+{
+namespace interrupt
+{
+/*!
+ * \brief IRQ handler registered with the IrqDispatcher.
+ *
+ * \param context Pointer passed to IrqDispatcher::Register().
+ *
+ * \return \c true if the handler's device raised the interrupt. Handlers of
+ *         a shared line that find nothing to do return \c false.
+ */
+typedef bool (*IrqHandlerFn)(void* context);
+
+/*!
+ * \struct IrqCounters
+ * \brief Per IRQ line counters.
+ *
+ * Each line's counters sit on their own cache line, so the dispatch of one
+ * line never dirties the cache line of another.
+ */
+struct __attribute__((aligned(64))) IrqCounters
+{
+    uint32_t hits;      /*!< Interrupts dispatched on the line. */
+    uint32_t unhandled; /*!< Interrupts that no handler claimed. */
+}; // end IrqCounters
+
+/*!
+ * \class IrqDispatcher
+ * \brief Table driven dispatch of the IRQs.
+ *
+ * irq_handler() hands every IRQ to Dispatch(), which looks up the line's
+ * handlers by index and calls each of them with its context pointer. Drivers
+ * Register() their handlers at runtime. Several handlers on one line form a
+ * chain, they are all called since any device on a shared line may have
+ * raised the interrupt.
+ *
+ * Registering the first handler of a line unmasks it at the IrqChip,
+ * unregistering the last one masks it again. Dispatch() sends the EOI after
+ * the handlers ran, handlers must not send one themselves. Interrupts on
+ * lines without handlers are only counted. Spurious interrupts are counted
+ * separately.
+ *
+ * Handler slots come from a fixed pool of #kMaxHandlers entries. This is a
+ * singleton class.
+ */
+class IrqDispatcher
+{
+public:
+    static const uint8_t kNumIrqs     = IrqChip::kMaxLines; /*!< Number of IRQ lines. */
+    static const size_t  kMaxHandlers = 32;                 /*!< Max registered handlers. */
+
+    ~IrqDispatcher() = default;
+
+    /* Disable copy construction and copy assignment. */
+    IrqDispatcher(const IrqDispatcher&) = delete;
+    IrqDispatcher& operator=(const IrqDispatcher&) = delete;
+
+    /* Disable move construction and move assignment. */
+    IrqDispatcher(IrqDispatcher&&) = delete;
+    IrqDispatcher& operator=(IrqDispatcher&&) = delete;
+
+    /*!
+     * \brief Return the singleton instance of IrqDispatcher.
+     */
+    static IrqDispatcher& GetInstance();
+
+    /*!
+     * \brief Add \a handler to the chain of IRQ line \a irq.
+     *
+     * \param irq IRQ line in the range [0, #kNumIrqs).
+     * \param handler Function called on every interrupt of the line.
+     * \param context Pointer passed to \a handler.
+     *
+     * \return \c false if \a irq is out of range, \a handler is null or all
+     *         #kMaxHandlers slots are in use.
+     */
+    bool Register(uint8_t irq, IrqHandlerFn handler, void* context);
+
+    /*!
+     * \brief Remove the \a handler and \a context pair from IRQ line \a irq.
+     *
+     * \return \c true if the pair was registered.
+     */
+    bool Unregister(uint8_t irq, IrqHandlerFn handler, void* context);
+
+    /*!
+     * \brief Run the handlers of IRQ line \a irq and acknowledge it.
+     *
+     * Called by irq_handler() with interrupts disabled.
+     */
+    void Dispatch(uint8_t irq);
+
+    /*!
+     * \brief Return the counters of IRQ line \a irq.
+     *
+     * \param irq IRQ line in the range [0, #kNumIrqs).
+     */
+    const IrqCounters& GetCounters(uint8_t irq) const { return counters_[irq]; }
+
+    /*!
+     * \brief Return the number of spurious interrupts of the PICs and the
+     *        local APIC.
+     */
+    uint32_t GetSpurious() const
+        { return spurious_ + IrqChip::GetInstance().GetApicSpurious(); }
+
+private:
+    /*!
+     * \struct HandlerSlot
+     * \brief A registered handler, linked into its line's chain or the free
+     *        list.
+     */
+    struct HandlerSlot
+    {
+        IrqHandlerFn handler; /*!< Handler function. */
+        void*        context; /*!< Handler argument. */
+        HandlerSlot* next;    /*!< Next slot in the chain. */
+    }; // end HandlerSlot
+
+    IrqDispatcher();
+
+    IrqCounters  counters_[kNumIrqs];   /*!< Per line counters. */
+    HandlerSlot* lines_[kNumIrqs];      /*!< Handler chain of each line. */
+    HandlerSlot  slots_[kMaxHandlers];  /*!< Handler slot pool. */
+    HandlerSlot* free_;                 /*!< Free handler slots. */
+    uint32_t     spurious_;             /*!< Spurious interrupts. */
+}; // end IrqDispatcher
+} // end interrupt
+} // end cosmo
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace cosmo
+{
+namespace interrupt
+{
+/*!
+ * \class RingBuffer
+ * \brief Wait-free single producer, single consumer ring of \a N items.
+ *
+ * One side of the ring calls Push() and the other side Pop(), typically an
+ * IRQ handler and the code it hands data to. Neither call takes a lock,
+ * waits or disables interrupts, so the producer may interrupt the consumer
+ * at any point. Several producers or consumers need their own
+ * serialization.
+ *
+ * The producer keeps the statistics the ring is sized from: items dropped
+ * because the ring was full and the highest fill level seen.
+ *
+ * \tparam T Item type, copied in and out of the ring.
+ * \tparam N Capacity, a power of 2.
+ */
+template <typename T, uint32_t N>
+class RingBuffer
+{
+    static_assert((N > 0) && !(N & (N - 1)), "N must be a power of 2");
+
+public:
+    RingBuffer() : items_(), head_(0), tail_(0), dropped_(0), high_water_(0) { }
+    ~RingBuffer() = default;
+
+    /* Disable copy construction and copy assignment. */
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+
+    /* Disable move construction and move assignment. */
+    RingBuffer(RingBuffer&&) = delete;
+    RingBuffer& operator=(RingBuffer&&) = delete;
+
+    /*!
+     * \brief Append \a item, producer side.
+     *
+     * \return \c false if the ring is full, the item is dropped and counted.
+     */
+    bool Push(const T& item)
+    {
+        uint32_t head = head_;
+        uint32_t used = head - __atomic_load_n(&tail_, __ATOMIC_ACQUIRE);
+        if (N == used) {
+            dropped_++;
+            return false;
+        }
+
+        items_[head & (N - 1)] = item;
+        __atomic_store_n(&head_, head + 1, __ATOMIC_RELEASE);
+
+        if (used + 1 > high_water_)
+            high_water_ = used + 1;
+        return true;
+    }
+
+    /*!
+     * \brief Take the oldest item off the ring into \a item, consumer side.
+     *
+     * \return \c false if the ring is empty.
+     */
+    bool Pop(T* item)
+    {
+        uint32_t tail = tail_;
+        if (tail == __atomic_load_n(&head_, __ATOMIC_ACQUIRE))
+            return false;
+
+        *item = items_[tail & (N - 1)];
+        __atomic_store_n(&tail_, tail + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    /*!
+     * \brief Return \c true if the ring holds no items.
+     */
+    bool IsEmpty() const
+    {
+        return __atomic_load_n(&head_, __ATOMIC_ACQUIRE) ==
+               __atomic_load_n(&tail_, __ATOMIC_ACQUIRE);
+    }
+
+    /*!
+     * \brief Return the capacity of the ring.
+     */
+    static constexpr uint32_t GetCapacity() { return N; }
+
+    /*!
+     * \brief Return the number of items dropped because the ring was full.
+     */
+    uint32_t GetDropped() const { return __atomic_load_n(&dropped_, __ATOMIC_RELAXED); }
+
+    /*!
+     * \brief Return the highest number of items the ring held at once.
+     */
+    uint32_t GetHighWater() const { return __atomic_load_n(&high_water_, __ATOMIC_RELAXED); }
+
+private:
+    T        items_[N];   /*!< Ring storage. */
+    uint32_t head_;       /*!< Items pushed, only written by the producer. */
+    uint32_t tail_;       /*!< Items popped, only written by the consumer. */
+    uint32_t dropped_;    /*!< Items dropped on a full ring. */
+    uint32_t high_water_; /*!< Highest fill level seen. */
+}; // end RingBuffer
+} // end interrupt
+} // end cosmo
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "IrqDispatcher.h"
+#include "RingBuffer.h"
+
+namespace cosmo
+{
+namespace interrupt
+{
+/*!
+ * \brief Deferred work function queued with SoftIrq::Raise().
+ *
+ * \param data Value passed to SoftIrq::Raise().
+ */
+typedef void (*SoftIrqFn)(uint32_t data);
+
+/*!
+ * \class SoftIrq
+ * \brief Bottom halves of the IRQ handlers.
+ *
+ * IRQ handlers (top halves) only acknowledge their device and Raise() a work
+ * item for the rest. Raise() appends the item to the queue of the IRQ line in
+ * O(1) and marks the line pending. Run() drains the pending queues in IRQ
+ * line order with interrupts enabled. It is called by irq_handler() once the
+ * IRQ was acknowledged and by the idle loop.
+ *
+ * Each line's queue is a RingBuffer of #kQueueSize items with a single
+ * producer, the line's top half, and a single consumer, Run(). Items raised
+ * while the queue is full are dropped and counted.
+ *
+ * Run() is not reentrant. An interrupt that comes in while work items run
+ * leaves its work to the interrupted Run(). This is a singleton class.
+ */
+class SoftIrq
+{
+public:
+    static const uint32_t kQueueSize = 32; /*!< Items per line, a power of 2. */
+    static const int      kMaxRounds = 4;  /*!< Drain rounds per Run(). */
+
+    ~SoftIrq() = default;
+
+    /* Disable copy construction and copy assignment. */
+    SoftIrq(const SoftIrq&) = delete;
+    SoftIrq& operator=(const SoftIrq&) = delete;
+
+    /* Disable move construction and move assignment. */
+    SoftIrq(SoftIrq&&) = delete;
+    SoftIrq& operator=(SoftIrq&&) = delete;
+
+    /*!
+     * \brief Return the singleton instance of SoftIrq.
+     */
+    static SoftIrq& GetInstance();
+
+    /*!
+     * \brief Queue \a fn(\a data) on the queue of IRQ line \a irq.
+     *
+     * Must be called with interrupts disabled, normally from the top half of
+     * line \a irq.
+     *
+     * \return \c false if \a irq is out of range, \a fn is null or the queue
+     *         is full.
+     */
+    bool Raise(uint8_t irq, SoftIrqFn fn, uint32_t data);
+
+    /*!
+     * \brief Run the queued work items with interrupts enabled.
+     *
+     * The queues are drained at most #kMaxRounds times, so an interrupt storm
+     * can't keep the caller in here. Work that is left stays pending for the
+     * next call. The interrupt flag is restored before returning.
+     *
+     * \return \c true if any work item ran.
+     */
+    bool Run();
+
+    /*!
+     * \brief Return \c true if work items are waiting for Run().
+     */
+    bool IsPending() const { return 0 != __atomic_load_n(&pending_, __ATOMIC_RELAXED); }
+
+    /*!
+     * \brief Return the number of work items dropped because of full queues.
+     */
+    uint32_t GetDropped() const;
+
+private:
+    /*!
+     * \struct WorkItem
+     * \brief A deferred function call.
+     */
+    struct WorkItem
+    {
+        SoftIrqFn fn;   /*!< Function to call. */
+        uint32_t  data; /*!< Argument of fn. */
+    }; // end WorkItem
+
+    typedef RingBuffer<WorkItem, kQueueSize> Queue;
+
+    SoftIrq() : queues_(), pending_(0), running_(false) { }
+
+    /*!
+     * \brief Run up to #kQueueSize items of the queue of \a irq.
+     */
+    void Drain(uint8_t irq);
+
+    Queue    queues_[IrqDispatcher::kNumIrqs]; /*!< Work queue of each line. */
+    uint32_t pending_;                         /*!< Bit per line with work. */
+    bool     running_;                         /*!< Run() is active. */
+}; // end SoftIrq
+} // end interrupt
+} // end cosmo
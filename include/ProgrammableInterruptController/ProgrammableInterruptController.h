@@ -73,6 +73,15 @@ namespace pic
     void Init(int offset1=kDefaultMasterOffset,
               int offset2=kDefaultSlaveOffset);
 
+    /*!
+     * \brief Mask all IRQ lines of the master and slave PIC.
+     *
+     * Used once the IRQs are delivered through the APIC. The PICs keep
+     * their vector offsets, so a spurious interrupt they still raise lands
+     * on an IRQ vector rather than a CPU exception vector.
+     */
+    void Disable();
+
     /*!
      * \brief Mask a master/slave PIC IRQ line.
      *
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace cosmo
+{
+/*!
+ * \struct RamdiskFile
+ * \brief A regular file in a Ramdisk.
+ *
+ * The file data is not copied, \a data points into the ramdisk image.
+ */
+struct RamdiskFile
+{
+    static const size_t kMaxPath = 256; /*!< Max path length incl. the NUL. */
+
+    char        path[kMaxPath]; /*!< Path relative to the archive root. */
+    const void* data;           /*!< File contents inside the image. */
+    size_t      size;           /*!< File size in bytes. */
+}; // end RamdiskFile
+
+/*!
+ * \class Ramdisk
+ * \brief Read-only view of a ustar archive in memory.
+ *
+ * The initrd is a plain (uncompressed) POSIX ustar archive, as produced by
+ * <tt>tar --format=ustar</tt>. Every member is a 512 byte header followed by
+ * the member data padded to 512 bytes. The archive ends at two zero blocks
+ * or at the end of the image. Lookups walk the headers; the file data is
+ * used in place.
+ *
+ * Leading "./" and "/" are ignored in archive and lookup paths, so
+ * "etc/motd", "./etc/motd" and "/etc/motd" name the same file.
+ */
+class Ramdisk
+{
+public:
+    static const size_t kBlockSize = 512; /*!< ustar block size. */
+
+    Ramdisk() : image_(nullptr), size_(0) { }
+    ~Ramdisk() = default;
+
+    /* Default copy construction and copy assignment, the image is shared. */
+    Ramdisk(const Ramdisk&) = default;
+    Ramdisk& operator=(const Ramdisk&) = default;
+
+    /* Default move construction and move assignment. */
+    Ramdisk(Ramdisk&&) = default;
+    Ramdisk& operator=(Ramdisk&&) = default;
+
+    /*!
+     * \brief Attach the ramdisk to the archive at \a image.
+     *
+     * \param image Start of the archive, e.g. BootModules::Map().
+     * \param size Size of the archive in bytes.
+     *
+     * \return \c true if the archive starts with a valid ustar header or is
+     *         empty.
+     */
+    bool Init(const void* image, size_t size);
+
+    /*!
+     * \brief Look up the regular file \a path.
+     *
+     * \return \c true if found, \a file describes the file.
+     */
+    bool Open(const char* path, RamdiskFile* file) const;
+
+    /*!
+     * \brief Iterate over the regular files of the archive.
+     *
+     * \param cursor Iteration state, set to 0 before the first call.
+     * \param file Set to the next file.
+     *
+     * \return \c false once there are no more files.
+     */
+    bool Next(size_t* cursor, RamdiskFile* file) const;
+
+private:
+    /*!
+     * \brief Return the header at \a offset if it is a valid ustar header.
+     */
+    const uint8_t* Header(size_t offset) const;
+
+    const uint8_t* image_; /*!< Start of the archive. */
+    size_t         size_;  /*!< Size of the archive in bytes. */
+}; // end Ramdisk
+} // end cosmo
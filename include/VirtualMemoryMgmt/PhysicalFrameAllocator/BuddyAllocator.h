@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "SummaryBitmap.h"
+
+namespace cosmo
+{
+namespace vmem
+{
+/*!
+ * \class BuddyAllocator
+ * \brief Binary buddy bookkeeping for blocks of 2^order page frames.
+ *
+ * BuddyAllocator tracks free blocks of orders 0 through #kMaxOrder. Each
+ * order has its own SummaryBitmap in which an unset bit marks the head of a
+ * free block of exactly that order. Allocation takes the first free block of
+ * the smallest order that fits and splits it down, freeing coalesces a block
+ * with its buddy for as long as the buddy is also free. Both operations cost
+ * O(#kMaxOrder) bitmap updates, each of which is itself a handful of bit
+ * scans. BuddyAllocator deals in frame indices only and does not know which
+ * frames exist; callers seed it with FreeRange().
+ */
+class BuddyAllocator
+{
+public:
+    static const uint32_t kMaxOrder = 10; /*!< Largest order (4 MiB blocks). */
+
+    BuddyAllocator();
+    ~BuddyAllocator() = default;
+
+    /* Allow default copy construction and assignment. */
+    BuddyAllocator(const BuddyAllocator&) = default;
+    BuddyAllocator& operator=(const BuddyAllocator&) = default;
+
+    /* Allow default move construction and move assignment. */
+    BuddyAllocator(BuddyAllocator&&) = default;
+    BuddyAllocator& operator=(BuddyAllocator&&) = default;
+
+    /*!
+     * \brief Return the number of DWORDs of storage needed for \a nframes.
+     */
+    static size_t StorageWords(size_t nframes);
+
+    /*!
+     * \brief Initialize the allocator with no free blocks.
+     *
+     * \param storage Scratch space of at least StorageWords(\a nframes)
+     *                DWORDs.
+     * \param nframes Number of frames covered by the allocator.
+     */
+    void Init(uint32_t* storage, size_t nframes);
+
+    /*!
+     * \brief Allocate a block of 2^\a order frames.
+     *
+     * \return The index of the first frame in the block or -1 if no block
+     *         of \a order or larger is free.
+     */
+    int AllocBlock(uint32_t order);
+
+    /*!
+     * \brief Free the block of 2^\a order frames starting at \a frame.
+     */
+    void FreeBlock(uint32_t frame, uint32_t order);
+
+    /*!
+     * \brief Free the \a count frames starting at \a frame.
+     *
+     * The range is split into the largest naturally aligned blocks that fit
+     * and each is freed with FreeBlock().
+     */
+    void FreeRange(uint32_t frame, size_t count);
+
+    /*!
+     * \brief Return the number of free blocks of exactly \a order.
+     */
+    size_t GetFreeBlocks(uint32_t order) const
+        { return free_blocks_[order]; }
+
+private:
+    SummaryBitmap orders_[kMaxOrder + 1];      /*!< Free block heads per order. */
+    size_t        free_blocks_[kMaxOrder + 1]; /*!< Free block count per order. */
+}; // end BuddyAllocator
+} // end vmem
+} // end cosmo
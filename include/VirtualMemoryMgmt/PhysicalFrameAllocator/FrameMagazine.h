@@ -0,0 +1,258 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "Cpu.h"
+#include "PhysicalFrameAllocator.h"
+
+namespace cosmo
+{
+namespace vmem
+{
+/*!
+ * \class FrameMagazine
+ * \brief A LIFO cache of free blocks in front of PhysicalFrameAllocator.
+ *
+ * FrameMagazine keeps up to \a Depth recently freed blocks of 2^\a Order
+ * frames on a stack. AllocFrame() and FreeFrame() push and pop that stack in
+ * O(1) and only reach the PhysicalFrameAllocator to refill an empty
+ * magazine or drain a full one, half a magazine at a time. Blocks handed out
+ * are the most recently freed ones and are likely still cache hot.
+ *
+ * Cached blocks stay allocated in the PhysicalFrameAllocator but their
+ * FrameDescriptor holds no reference, so GetFrame() and PutFrame() of the
+ * allocator reject them. AllocFrame() hands a block out with a single
+ * reference like PhysicalFrameAllocator::AllocFrame().
+ *
+ * Interrupts are disabled while the magazine is touched, so all calls are
+ * safe from interrupt context. The longest interrupts-off window is one
+ * refill or drain of \a Depth / 2 blocks. Like GlobalDescriptorTable, each
+ * instantiation is a singleton.
+ *
+ * \tparam Depth Number of blocks the magazine can hold (at least 2).
+ * \tparam Order Log2 of the number of frames in each cached block.
+ */
+template <size_t Depth, uint32_t Order = 0>
+class FrameMagazine
+{
+public:
+    static_assert(Depth >= 2, "FrameMagazine Depth must be at least 2.");
+
+    static const size_t   kBatch       = Depth / 2;   /*!< Blocks moved per refill/drain. */
+    static const uint32_t kBlockFrames = 1U << Order; /*!< Frames per cached block. */
+
+    ~FrameMagazine() = default;
+
+    /* Disable copy construction and copy assignment. */
+    FrameMagazine(const FrameMagazine&) = delete;
+    FrameMagazine& operator=(const FrameMagazine&) = delete;
+
+    /* Disable move construction and move assignment. */
+    FrameMagazine(FrameMagazine&&) = delete;
+    FrameMagazine& operator=(FrameMagazine&&) = delete;
+
+    /*!
+     * \brief Return the singleton instance of this FrameMagazine.
+     */
+    static FrameMagazine& GetInstance();
+
+    /*!
+     * \brief Allocate a block of 2^\a Order frames.
+     *
+     * \return The physical address of the block or nullptr if both the
+     *         magazine and the PhysicalFrameAllocator are empty.
+     */
+    void* AllocFrame();
+
+    /*!
+     * \brief Return a block obtained from AllocFrame() to the magazine.
+     *
+     * The block is cached regardless of its reference count, see
+     * PhysicalFrameAllocator::FreeFrame().
+     */
+    void FreeFrame(void* frame);
+
+    /*!
+     * \brief Drop a reference to the allocated frame \a frame.
+     *
+     * Only available for single frame magazines. The last reference of a
+     * normal zone frame caches the frame, any other frame is released
+     * through PhysicalFrameAllocator::PutFrame().
+     *
+     * \return \c true if this was the last reference, \c false otherwise.
+     */
+    bool PutFrame(PhysAddr frame);
+
+    /*!
+     * \brief Return every cached block to the PhysicalFrameAllocator.
+     */
+    void Drain();
+
+    /*!
+     * \brief Return the number of blocks currently cached.
+     */
+    size_t GetCount() const { return count_; }
+
+    /*!
+     * \brief Return the number of allocations served from the magazine.
+     */
+    uint32_t GetHits() const { return hits_; }
+
+    /*!
+     * \brief Return the number of allocations that required a refill.
+     */
+    uint32_t GetMisses() const { return misses_; }
+
+private:
+    FrameMagazine() : count_(0), hits_(0), misses_(0) { }
+
+    /*!
+     * \brief Move up to #kBatch blocks from the allocator to the magazine.
+     */
+    void Refill();
+
+    /*!
+     * \brief Move the \a n oldest blocks from the magazine to the allocator.
+     */
+    void Release(size_t n);
+
+    /*!
+     * \brief Set the reference count of every frame of \a block to
+     *        \a refcount and clear its flags and owner.
+     */
+    static void SetRefs(void* block, uint16_t refcount);
+
+    void*    frames_[Depth]; /*!< Stack of cached blocks, newest on top. */
+    size_t   count_;         /*!< Number of cached blocks. */
+    uint32_t hits_;          /*!< Allocations served without a refill. */
+    uint32_t misses_;        /*!< Allocations that triggered a refill. */
+}; // end FrameMagazine
+
+template <size_t Depth, uint32_t Order>
+FrameMagazine<Depth, Order>& FrameMagazine<Depth, Order>::GetInstance()
+{
+    static FrameMagazine<Depth, Order> magazine;
+    return magazine;
+}
+
+template <size_t Depth, uint32_t Order>
+void FrameMagazine<Depth, Order>::Refill()
+{
+    auto&  falloc = PhysicalFrameAllocator::GetInstance();
+    size_t first  = count_;
+    if (!Order) {
+        count_ += falloc.AllocFrameBatch(&frames_[count_], kBatch);
+    } else {
+        for (size_t i = 0; i < kBatch; ++i) {
+            void* block =
+                falloc.AllocFrames(kBlockFrames,
+                                   PhysicalFrameAllocator::kFrameSize << Order);
+            if (!block)
+                break;
+            frames_[count_++] = block;
+        }
+    }
+
+    for (size_t i = first; i < count_; ++i)
+        SetRefs(frames_[i], 0);
+}
+
+template <size_t Depth, uint32_t Order>
+void FrameMagazine<Depth, Order>::Release(size_t n)
+{
+    auto& falloc = PhysicalFrameAllocator::GetInstance();
+    if (!Order) {
+        falloc.FreeFrameBatch(frames_, n);
+    } else {
+        for (size_t i = 0; i < n; ++i)
+            falloc.FreeFrames(frames_[i], kBlockFrames);
+    }
+
+    /* Slide the remaining (more recently freed) blocks down. */
+    count_ -= n;
+    memmove(&frames_[0], &frames_[n], count_ * sizeof(void*));
+}
+
+template <size_t Depth, uint32_t Order>
+void FrameMagazine<Depth, Order>::SetRefs(void* block, uint16_t refcount)
+{
+    FrameDescriptor* desc =
+        PhysicalFrameAllocator::GetInstance().GetDescriptor(block);
+    for (uint32_t i = 0; i < kBlockFrames; ++i) {
+        desc[i].refcount = refcount;
+        desc[i].flags    = 0;
+        desc[i].owner    = kFrameOwnerNone;
+    }
+}
+
+template <size_t Depth, uint32_t Order>
+void* FrameMagazine<Depth, Order>::AllocFrame()
+{
+    cpu::InterruptGuard guard;
+
+    if (count_) {
+        hits_++;
+    } else {
+        misses_++;
+        Refill();
+        if (!count_)
+            return nullptr;
+    }
+
+    void* block = frames_[--count_];
+    SetRefs(block, 1);
+    return block;
+}
+
+template <size_t Depth, uint32_t Order>
+void FrameMagazine<Depth, Order>::FreeFrame(void* frame)
+{
+    if (!frame)
+        /* NOOP if given a NULL frame. */
+        return;
+
+    cpu::InterruptGuard guard;
+
+    /* A full magazine gives back its oldest, coldest half. */
+    if (Depth == count_)
+        Release(kBatch);
+    SetRefs(frame, 0);
+    frames_[count_++] = frame;
+}
+
+template <size_t Depth, uint32_t Order>
+bool FrameMagazine<Depth, Order>::PutFrame(PhysAddr frame)
+{
+    static_assert(0 == Order, "PutFrame() needs a single frame magazine.");
+
+    auto&               falloc = PhysicalFrameAllocator::GetInstance();
+    cpu::InterruptGuard guard;
+
+    /* Shared frames only lose a reference. DMA frames, which AllocFrame()
+       only hands out once the normal zone is exhausted, and frames above
+       the normal zone bypass the cache. */
+    const FrameDescriptor* desc = falloc.GetDescriptor(frame);
+    if (!desc || (1 != desc->refcount) ||
+        (frame < PhysicalFrameAllocator::kDmaZoneEnd) ||
+        (frame >= PhysicalFrameAllocator::kNormalZoneEnd))
+        return falloc.PutFrame(frame);
+
+    FreeFrame(reinterpret_cast<void*>(static_cast<uintptr_t>(frame)));
+    return true;
+}
+
+template <size_t Depth, uint32_t Order>
+void FrameMagazine<Depth, Order>::Drain()
+{
+    cpu::InterruptGuard guard;
+    Release(count_);
+}
+
+/*!
+ * \brief Single frame magazine shared by the page frame hot paths.
+ */
+typedef FrameMagazine<32> PageMagazine;
+} // end vmem
+} // end cosmo
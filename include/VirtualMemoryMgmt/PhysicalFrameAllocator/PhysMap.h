@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace cosmo
+{
+namespace vmem
+{
+/*!
+ * The physmap maps physical memory linearly at #kPhysMapBase with 4 MiB PSE
+ * pages. It covers RAM up to #kPhysMapSize, i.e. the DMA and normal zones of
+ * the PhysicalFrameAllocator, so any frame allocated outside of the high
+ * zone can be accessed through PhysToVirt(). The mapping is installed by
+ * VirtualMemoryManager::Init(). Before that only the first 4 MiB mapped by
+ * the boot page directory are accessible.
+ *
+ * The top 128 MiB of the address space stay free for page granular
+ * mappings.
+ */
+static const uint32_t kPhysMapBase = 0xC0000000; /*!< Virtual address of physical address 0. */
+static const uint32_t kPhysMapSize = 0x38000000; /*!< Bytes of physical memory covered (896 MiB). */
+
+/*!
+ * \brief Return the physmap address of the physical address \a phys.
+ *
+ * \param phys Physical address below #kPhysMapSize.
+ */
+inline void* PhysToVirt(uint32_t phys)
+{
+    return reinterpret_cast<void*>(kPhysMapBase + phys);
+}
+
+/*!
+ * \brief Return the physmap address of a frame returned by the
+ *        PhysicalFrameAllocator.
+ */
+inline void* PhysToVirt(const void* frame)
+{
+    return PhysToVirt(static_cast<uint32_t>(reinterpret_cast<uintptr_t>(frame)));
+}
+
+/*!
+ * \brief Return the physical address behind the physmap address \a virt.
+ *
+ * \param virt Address in [#kPhysMapBase, #kPhysMapBase + #kPhysMapSize).
+ */
+inline uint32_t VirtToPhys(const void* virt)
+{
+    return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(virt)) -
+           kPhysMapBase;
+}
+
+/*!
+ * \brief Return \c true if \a virt lies in the physmap.
+ */
+inline bool IsPhysMapAddress(const void* virt)
+{
+    uint32_t addr = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(virt));
+    return (addr >= kPhysMapBase) && ((addr - kPhysMapBase) < kPhysMapSize);
+}
+} // end vmem
+} // end cosmo
@@ -4,6 +4,8 @@
 #include <stddef.h>
 
 #include "multiboot.h"
+#include "SummaryBitmap.h"
+#include "BuddyAllocator.h"
 
 namespace cosmo
 {
@@ -13,6 +15,12 @@ namespace cosmo
  */
 namespace vmem
 {
+#ifdef COSMO_PAE
+typedef uint64_t PhysAddr; /*!< Physical address, PAE reaches past 4 GiB. */
+#else
+typedef uint32_t PhysAddr; /*!< Physical address. */
+#endif
+
 /*!
  * \struct KernelDescriptor
  * \brief This struct captures kernel addressing info provided at boot time.
@@ -26,6 +34,47 @@ struct KernelDescriptor
     uint32_t kernel_virtual_base;   /*!< Virtual base address of kernel space. */
 }; // end KernelDescriptor
 
+/*!
+ * \enum FrameFlags
+ * \brief Bits of FrameDescriptor::flags.
+ */
+enum FrameFlags : uint8_t
+{
+    kFrameReserved    = 1 << 0, /*!< In use since boot (kernel, allocator or non-RAM). */
+    kFrameShared      = 1 << 1, /*!< Mapped by more than one holder. */
+    kFrameCopyOnWrite = 1 << 2  /*!< Must be copied before it is written. */
+}; // end FrameFlags
+
+/*!
+ * \enum FrameOwner
+ * \brief Values of FrameDescriptor::owner.
+ *
+ * The owner is a hint for debugging and reclaim. The allocator never
+ * interprets it.
+ */
+enum FrameOwner : uint8_t
+{
+    kFrameOwnerNone,      /*!< Free or unclassified frame. */
+    kFrameOwnerKernel,    /*!< Kernel data. */
+    kFrameOwnerPageTable, /*!< Page directory or page table. */
+    kFrameOwnerUser,      /*!< User space memory. */
+    kFrameOwnerSlab       /*!< Slab of the kernel heap. */
+}; // end FrameOwner
+
+/*!
+ * \struct FrameDescriptor
+ * \brief Per frame metadata kept alongside the frame bitmap.
+ *
+ * The descriptor is a single DWORD so that the array costs 0.1% of RAM.
+ */
+struct FrameDescriptor
+{
+    uint16_t refcount;  /*!< Number of references held, 0 if free or reserved. */
+    uint8_t  flags;     /*!< Bitwise OR of #FrameFlags. */
+    uint8_t  zone  : 2; /*!< PhysicalFrameAllocator::Zone of the frame. */
+    uint8_t  owner : 6; /*!< #FrameOwner hint. */
+}; // end FrameDescriptor
+
 /*!
  * \brief Set bit \a bit in the \a bitmap.
  */
@@ -46,21 +95,105 @@ int BitmapTest(uint32_t* bitmap, int bit);
  */
 int BitmapFirstUnset(uint32_t* bitmap, size_t size);
 
+/*!
+ * \brief Set the \a count bits starting at \a bit in the \a bitmap.
+ *
+ * Whole DWORDs inside the range are filled with a single memset, only the
+ * partial DWORDs at either edge are masked.
+ */
+void BitmapSetRange(uint32_t* bitmap, uint32_t bit, size_t count);
+
+/*!
+ * \brief Clear the \a count bits starting at \a bit in the \a bitmap.
+ *
+ * Whole DWORDs inside the range are zeroed with a single memset, only the
+ * partial DWORDs at either edge are masked.
+ */
+void BitmapUnsetRange(uint32_t* bitmap, uint32_t bit, size_t count);
+
+/*!
+ * \brief Return the number of set bits among the first \a size bits.
+ */
+size_t BitmapCountSet(const uint32_t* bitmap, size_t size);
+
 /*!
  * \class PhysicalFrameAllocator
  * \brief Manage allocation of physical memory frames.
  *
  * PhysicalFrameAllocator provides a handle for the management of physical
  * memory frames. This class uses a bitmap as its frame bookkeeping
- * data structure. The PhysicalFrameAllocator API provides a basic alloc/free
- * interface that allocates/frees a #kFrameSize chunk of memory. This is a
- * singleton class whose Init() function must only be called once on kernel
- * startup.
+ * data structure. The bitmap is topped by a SummaryBitmap hierarchy so that
+ * locating a free frame costs a few bit scans regardless of how much memory
+ * is installed or in use. The PhysicalFrameAllocator API provides a basic
+ * alloc/free interface that allocates/frees a #kFrameSize chunk of memory.
+ * This is a singleton class whose Init() function must only be called once
+ * on kernel startup.
+ *
+ * The search backend is selected at build time. By default free frames are
+ * located with the summary bitmap. Configuring with
+ * COSMO_FRAME_ALLOCATOR=buddy defines \c COSMO_PFA_BUDDY and hands block
+ * selection to a BuddyAllocator seeded from the Multiboot memory map, with
+ * the bitmap kept as the record of which frames are in use. In buddy mode
+ * AllocFrames() is limited to blocks of at most 2^BuddyAllocator::kMaxOrder
+ * frames.
+ *
+ * Physical memory is split into the zones listed in #Zone. Every zone has its
+ * own summary bitmap (and buddy lists), free frame count and next fit cursor.
+ * Allocations name the zone they prefer and only fall back to the zones below
+ * it once the preferred zone is exhausted, so the scarce DMA capable frames
+ * are not handed out to callers that could have used any frame.
+ *
+ * Every frame also has a FrameDescriptor holding a reference count. Frames
+ * are allocated with a single reference. GetFrame() adds a reference to share
+ * a frame (e.g. between address spaces) and PutFrame() drops one, freeing the
+ * frame when the last reference goes away.
+ *
+ * Building with COSMO_PAE=ON defines \c COSMO_PAE and fills Zone::kPae with
+ * the memory above 4 GiB. Those frames don't fit in a pointer, so the
+ * pointer based calls never return them. They are allocated with
+ * AllocPhysFrame() and released through the #PhysAddr overloads.
  */
 class PhysicalFrameAllocator
 {
 public:
-    static const uint32_t kFrameSize = 4096; /*!< Size of a page frame in bytes. */
+    static const uint32_t kFrameSize      = 4096; /*!< Size of a page frame in bytes. */
+    static const uint32_t kFramesPerChunk = 1024; /*!< Frames per 4 MiB occupancy chunk. */
+
+    /*!
+     * \enum AllocPolicy
+     * \brief Frame search policies used by AllocFrame().
+     */
+    enum class AllocPolicy
+    {
+        kFirstFit, /*!< Always return the lowest free frame. */
+        kNextFit   /*!< Resume the search after the last allocated frame. */
+    }; // end AllocPolicy
+
+    /*!
+     * \enum Zone
+     * \brief Physical memory zones.
+     *
+     * Zones are listed from the lowest to the highest physical addresses. An
+     * allocation from a zone falls back to the zones listed before it:
+     * kPae -> kHigh -> kNormal -> kDma.
+     */
+    enum class Zone
+    {
+        kDma,    /*!< Frames below #kDmaZoneEnd (ISA DMA capable). */
+        kNormal, /*!< Frames in [#kDmaZoneEnd, #kNormalZoneEnd). */
+        kHigh,   /*!< Frames in [#kNormalZoneEnd, #kHighZoneEnd). */
+        kPae     /*!< Frames at and above #kHighZoneEnd (COSMO_PAE builds only). */
+    }; // end Zone
+
+    static const int      kNumZones      = 4;          /*!< Number of #Zone values. */
+    static const uint32_t kDmaZoneEnd    = 0x01000000; /*!< End of the DMA zone (16 MiB). */
+    static const uint32_t kNormalZoneEnd = 0x38000000; /*!< End of the normal zone (896 MiB). */
+    static const uint64_t kHighZoneEnd   = 0x100000000ULL; /*!< End of the high zone (4 GiB). */
+#ifdef COSMO_PAE
+    static const uint64_t kMaxPhysAddr   = 0x1000000000ULL; /*!< End of usable memory (64 GiB). */
+#else
+    static const uint64_t kMaxPhysAddr   = kHighZoneEnd;    /*!< End of usable memory (4 GiB). */
+#endif
 
     ~PhysicalFrameAllocator() = default;
 
@@ -77,19 +210,41 @@ public:
      */
     static PhysicalFrameAllocator& GetInstance();
 
+    /*!
+     * \brief Return the size of physical memory in KB.
+     *
+     * The size is the end of the highest available region of the Multiboot
+     * memory map, capped at #kMaxPhysAddr. The \c mem_upper field only
+     * counts the memory below the first hole and is used when there is no
+     * memory map.
+     *
+     * \param mb_info GRUB Multiboot info structure.
+     * \param virtual_base Virtual base address of kernel space.
+     */
+    static size_t GetMemorySize(const multiboot_info_t* mb_info,
+                                uint32_t virtual_base);
+
     /*!
      * \brief Initialize the physical frame allocator.
      *
-     * Initialization of the allocator is a three step process:
+     * Initialization of the allocator is a four step process:
      *   (1) Initialize the underlying bitmap used to bookkeep frames.
      *   (2) Mark frames as free using the Multiboot info structure for
      *       guidance.
-     *   (3) Explicitly mark kernel frames as in use.
+     *   (3) Explicitly mark kernel and Multiboot module frames as in use.
+     *   (4) Build the summary levels on top of the bitmap.
+     *
+     * Steps (2) and (3) mark each memory map entry or reservation with one
+     * range operation instead of one call per frame. Filling the bitmap,
+     * building the summary levels, counting the used frames and setting up
+     * the frame descriptors still walk the bitmap a word at a time, so the
+     * cost of Init() remains linear in the amount of RAM.
      *
      * \param mb_info GRUB Multiboot info structure.
      * \param pmmap_addr Physical address at which the physical memory
-     *                   allocator will place its data structures (bitmap).
-     * \param pmmap_size Size of physical memory allocator scratch space in KB.
+     *                   allocator will place its data structures (bitmap,
+     *                   summary levels and frame descriptors).
+     * \param pmmap_size Size of physical memory in KB, see GetMemorySize().
      * \param kernel_desc Kernel descriptor.
      */
     void Init(const multiboot_info_t* mb_info,
@@ -112,26 +267,206 @@ public:
     size_t GetUsedFrames() const
         { return used_frames_; }
 
+    /*!
+     * \brief Return the number of frames that make up zone \a zone.
+     */
+    size_t GetZoneFrames(Zone zone) const
+        { return zones_[static_cast<int>(zone)].num_frames; }
+
+    /*!
+     * \brief Return the number of free frames in zone \a zone.
+     */
+    size_t GetZoneFreeFrames(Zone zone) const
+        { return zones_[static_cast<int>(zone)].free_frames; }
+
+    /*!
+     * \brief Return the descriptor of \a frame.
+     *
+     * \return A pointer to the descriptor or nullptr if \a frame lies
+     *         beyond the end of memory.
+     */
+    FrameDescriptor* GetDescriptor(PhysAddr frame);
+
+    /*!
+     * \brief Pointer overload of GetDescriptor().
+     */
+    FrameDescriptor* GetDescriptor(void* frame)
+        { return GetDescriptor(ToPhysAddr(frame)); }
+
+    /*!
+     * \brief Add a reference to the allocated frame \a frame.
+     *
+     * A frame with more than one reference is flagged #kFrameShared.
+     *
+     * \return \c true on success, \c false if \a frame is not allocated
+     *         or its reference count is saturated.
+     */
+    bool GetFrame(PhysAddr frame);
+
+    /*!
+     * \brief Pointer overload of GetFrame().
+     */
+    bool GetFrame(void* frame)
+        { return GetFrame(ToPhysAddr(frame)); }
+
+    /*!
+     * \brief Drop a reference to the allocated frame \a frame.
+     *
+     * \return \c true if this was the last reference and \a frame was
+     *         freed, \c false otherwise.
+     */
+    bool PutFrame(PhysAddr frame);
+
+    /*!
+     * \brief Pointer overload of PutFrame().
+     */
+    bool PutFrame(void* frame)
+        { return PutFrame(ToPhysAddr(frame)); }
+
+    /*!
+     * \brief Return the number of #kFramesPerChunk frame chunks in memory.
+     */
+    size_t GetNumChunks() const
+        { return num_chunks_; }
+
+    /*!
+     * \brief Return the number of free frames in chunk \a chunk.
+     *
+     * Chunk \a chunk covers frames [\a chunk * #kFramesPerChunk,
+     * (\a chunk + 1) * #kFramesPerChunk). Comparing the per chunk counts
+     * shows how fragmented physical memory is.
+     */
+    uint32_t GetChunkFreeFrames(size_t chunk) const
+        { return chunk_free_[chunk]; }
+
+    /*!
+     * \brief Select the search policy used by AllocFrame().
+     *
+     * The default policy is AllocPolicy::kNextFit. Each zone keeps its own
+     * next fit cursor. The policy only applies to the bitmap backend, the
+     * buddy backend always picks the lowest free block of the smallest
+     * fitting order.
+     */
+    void SetAllocPolicy(AllocPolicy policy)
+        { policy_ = policy; }
+
     /*!
      * \brief Allocate a page frame.
      *
+     * \param zone Preferred zone. Lower zones are used only when \a zone has
+     *             no free frames left. Zone::kPae is treated as Zone::kHigh.
+     *
      * \return The address of a #kFrameSize bytes frame of memory. If no frames
      *         are available, nullptr is returned.
      */
-    void* AllocFrame();
+    void* AllocFrame(Zone zone=Zone::kNormal);
 
     /*!
-     * \brief Free a frame previously allocated by a call to AllocFrame().
+     * \brief Allocate a page frame that may lie above 4 GiB.
+     *
+     * Frames above the normal zone are not covered by the physmap and must
+     * be mapped before they can be accessed.
+     *
+     * \param zone Preferred zone, see AllocFrame().
+     *
+     * \return The physical address of the frame or 0 if no frames are
+     *         available.
+     */
+    PhysAddr AllocPhysFrame(Zone zone=Zone::kPae);
+
+    /*!
+     * \brief Free a frame previously allocated by a call to AllocFrame() or
+     *        AllocPhysFrame().
      *
      * Passing FreeFrame() an address to a frame not previously allocated
-     * via a call to AllocFrame() leads to undefined behavior.
+     * via a call to AllocFrame() leads to undefined behavior. The frame is
+     * freed regardless of its reference count, release shared frames with
+     * PutFrame() instead.
      *
      * \param frame Address returned by a preceding call to AllocFrame().
      */
-    void FreeFrame(void* frame);
+    void FreeFrame(PhysAddr frame);
+
+    /*!
+     * \brief Pointer overload of FreeFrame().
+     */
+    void FreeFrame(void* frame)
+        { FreeFrame(ToPhysAddr(frame)); }
+
+    /*!
+     * \brief Allocate up to \a count individual page frames in one call.
+     *
+     * AllocFrameBatch() behaves like \a count calls to AllocFrame() but
+     * continues each search where the previous one stopped and updates the
+     * allocator counters once for the whole batch.
+     *
+     * \param frames Output array of at least \a count entries.
+     * \param count Number of frames requested.
+     * \param zone Preferred zone, see AllocFrame().
+     *
+     * \return The number of frames written to \a frames.
+     */
+    size_t AllocFrameBatch(void** frames, size_t count,
+                           Zone zone=Zone::kNormal);
+
+    /*!
+     * \brief Free \a count frames previously allocated one at a time.
+     *
+     * \param frames Array of frames returned by AllocFrame() or
+     *               AllocFrameBatch().
+     * \param count Number of entries in \a frames.
+     */
+    void FreeFrameBatch(void* const* frames, size_t count);
+
+    /*!
+     * \brief Allocate \a count physically contiguous page frames.
+     *
+     * The bitmap is searched a DWORD at a time for a run of \a count free
+     * frames whose first frame is \a alignment aligned. When \a count is a
+     * power of two and the run is naturally aligned, whole aligned blocks are
+     * tested with a handful of mask operations per DWORD.
+     *
+     * \param count Number of #kFrameSize frames to allocate.
+     * \param alignment Required alignment of the first frame in bytes. Must
+     *                  be a power of two. Values below #kFrameSize are
+     *                  treated as #kFrameSize.
+     * \param zone Preferred zone, see AllocFrame(). A run never straddles
+     *             two zones.
+     *
+     * \return The address of the first frame in the run. If no suitable run
+     *         exists or the arguments are invalid, nullptr is returned.
+     */
+    void* AllocFrames(size_t count, uint32_t alignment=kFrameSize,
+                      Zone zone=Zone::kNormal);
+
+    /*!
+     * \brief Free a run of frames previously allocated by AllocFrames().
+     *
+     * \param frames Address returned by a preceding call to AllocFrames().
+     * \param count The \a count passed to AllocFrames().
+     */
+    void FreeFrames(void* frames, size_t count);
 
 private:
     static const uint32_t kFramesPerDword = 32; /*!< Number of frames stored in each double word. */
+    static const uint32_t kFrameShift     = 12; /*!< log2(#kFrameSize). */
+
+    /*!
+     * \struct FrameZone
+     * \brief Bookkeeping of a single #Zone.
+     *
+     * Frame indices handed to #frames and #buddy are relative to #base. The
+     * level 0 bitmap of #frames is the slice of #pmmap_ covering the zone.
+     */
+    struct FrameZone
+    {
+        uint32_t       base;        /*!< Index of the first frame in the zone. */
+        size_t         num_frames;  /*!< Number of frames in the zone. */
+        size_t         free_frames; /*!< Number of free frames in the zone. */
+        uint32_t       cursor;      /*!< Next fit search start (zone relative). */
+        SummaryBitmap  frames;      /*!< Summary hierarchy over the zone's frames. */
+        BuddyAllocator buddy;       /*!< Buddy backend (COSMO_PFA_BUDDY builds only). */
+    }; // end FrameZone
 
     /*!
      * \brief Default initializes PhysicalFrameAllocator members.
@@ -142,7 +477,19 @@ private:
      * \brief Convert a size in KB to number of frames.
      */
     uint32_t KilobytesToFrames(uint32_t mem_size_kb) const
-        { return ((mem_size_kb * 1024) / kFrameSize); }
+        { return mem_size_kb / (kFrameSize / 1024); }
+
+    /*!
+     * \brief Convert a pointer based frame address to a #PhysAddr.
+     */
+    static PhysAddr ToPhysAddr(void* frame)
+        { return static_cast<PhysAddr>(reinterpret_cast<uintptr_t>(frame)); }
+
+    /*!
+     * \brief Return the index of the frame at \a frame.
+     */
+    static uint32_t FrameIndex(PhysAddr frame)
+        { return static_cast<uint32_t>(frame >> kFrameShift); }
 
     /*!
      * \brief Return \c true if \a addr is \a alignment aligned.
@@ -170,30 +517,33 @@ private:
      * \brief Initialize a region of memory.
      *
      * InitRegion() updates the PhysicalFrameAllocator bitmap to mark frames
-     * in the range [base, base+size] as in use. Initialization is
-     * automatically frame size aligned.
+     * in the range [base, base+size) as free. Only frames that lie entirely
+     * inside the region are marked and frames beyond #max_frames_ are
+     * ignored.
      *
-     * \param base A virtual base address.
+     * \param base A physical base address.
      * \param size Size of the memory region in bytes.
      */
-    void InitRegion(uint32_t base, size_t size);
+    void InitRegion(uint64_t base, uint64_t size);
 
     /*!
      * \brief Free a region of memory.
      *
      * FreeRegion updates the PhysicalFrameAllocator bitmap to mark frames
-     * in the range [base, base+size) as free.
+     * in the range [base, base+size) as in use. Every frame the region
+     * touches is marked.
      *
-     * \param base A virtual base address.
+     * \param base A physical base address.
      * \param size Size of the memory region in bytes.
      */
-    void FreeRegion(uint32_t base, size_t size);
+    void FreeRegion(uint64_t base, uint64_t size);
 
     /*!
      * \brief Mark available frames according to Multiboot memory map.
      *
      * InitAvailableRegions() scans the parameter memory map and initializes
-     * any regions that Multiboot indicates are available.
+     * any regions that Multiboot indicates are available. Addresses and
+     * lengths are taken in full 64 bits and clipped to the end of memory.
      *
      * \param mmap_addr Memory map buffer address provided by Multiboot info
      *                  struct.
@@ -215,14 +565,126 @@ private:
      *
      * \param kernel_start Kernel virtual base address.
      * \param kernel_end Kernel virtual end address.
+     * \param meta_start Physical address of the allocator metadata.
+     */
+    void DeinitKernel(uint32_t kernel_start, uint32_t kernel_end,
+                      uint32_t meta_start);
+
+    /*!
+     * \brief Mark Multiboot module memory as in use.
+     *
+     * Modules are loaded into memory the Multiboot map reports as
+     * available. Their frames, the module list and the module command lines
+     * are kept in use so that the modules can be used in place.
+     *
+     * \param mb_info GRUB Multiboot info structure.
+     * \param virtual_base Virtual base address of kernel space.
+     */
+    void DeinitModules(const multiboot_info_t* mb_info, uint32_t virtual_base);
+
+    /*!
+     * \brief Reserve \a bytes of metadata space after the bitmap.
+     *
+     * \return The virtual address of the reserved space.
+     */
+    void* CarveMetadata(size_t bytes);
+
+    /*!
+     * \brief Return the zone that frame \a frame belongs to.
+     */
+    FrameZone& ZoneOf(uint32_t frame);
+
+    /*!
+     * \brief Allocate one frame from \a zone only.
+     *
+     * \return Index of the allocated frame or -1 if \a zone is full.
+     */
+    int AllocZoneFrame(FrameZone& zone);
+
+    /*!
+     * \brief Allocate up to \a count frames from \a zone only.
+     *
+     * \return The number of frames written to \a frames.
+     */
+    size_t AllocZoneBatch(FrameZone& zone, void** frames, size_t count);
+
+    /*!
+     * \brief Allocate \a count contiguous frames from \a zone only.
+     *
+     * \return Index of the first frame in the run or -1 if none exists.
+     */
+    int AllocZoneFrames(FrameZone& zone, uint32_t count, uint32_t step);
+
+    /*!
+     * \brief Set up #descs_ once the bitmap is final.
+     *
+     * Frames that are in use at this point are flagged #kFrameReserved.
+     */
+    void InitDescriptors();
+
+    /*!
+     * \brief Reset the descriptors of \a count frames at \a frame.
+     *
+     * The flags and owner are cleared and the reference count set to
+     * \a refcount. The zone is kept.
+     */
+    void ResetDescriptors(uint32_t frame, size_t count, uint16_t refcount);
+
+    /*!
+     * \brief Recount the free frames of every chunk from the bitmap.
+     */
+    void CountChunks();
+
+    /*!
+     * \brief Update the chunk free counts for \a count frames at \a frame.
+     *
+     * \param frame Index of the first frame.
+     * \param count Number of frames.
+     * \param freed \c true if the frames were freed, \c false if allocated.
+     */
+    void AdjustChunks(uint32_t frame, size_t count, bool freed);
+
+    /*!
+     * \brief Hand every free run of \a zone to its buddy backend.
+     */
+    void SeedBuddy(FrameZone& zone);
+
+    /*!
+     * \brief Find \a count free frames starting at a multiple of \a step.
+     *
+     * General case search used by AllocFrames(). The scan jumps to the next
+     * free frame using the summary levels and measures free runs a DWORD at
+     * a time, so each bitmap DWORD is visited a bounded number of times.
+     *
+     * \return Zone relative index of the first frame in the run or -1 if
+     *         none exists in \a zone.
+     */
+    int FindFreeRun(const FrameZone& zone, uint32_t count,
+                    uint32_t step) const;
+
+    /*!
+     * \brief Find a naturally aligned block of \a count free frames.
+     *
+     * Fast path of AllocFrames() for power of two \a count values with a
+     * power of two \a step that is a multiple of \a count.
+     *
+     * \return Zone relative index of the first frame in the block or -1 if
+     *         none exists in \a zone.
      */
-    void DeinitKernel(uint32_t kernel_start, uint32_t kernel_end);
+    int FindFreeBlock(const FrameZone& zone, uint32_t count,
+                      uint32_t step) const;
 
     size_t    mem_size_;    /*!< Size of memory in KB. */
     size_t    max_frames_;  /*!< Maximum number of page frames supported. */
     size_t    used_frames_; /*!< Number of allocated page frames. */
     size_t    pmmap_size_;  /*!< Number of DWORDs used to store page data. */
+    size_t    meta_size_;   /*!< Bytes of allocator metadata past the kernel. */
     uint32_t* pmmap_;       /*!< Pointer to a bitmap of page frames. */
+    FrameZone zones_[kNumZones]; /*!< Per zone bookkeeping over #pmmap_. */
+    size_t    num_chunks_;  /*!< Number of #kFramesPerChunk chunks. */
+    uint16_t* chunk_free_;  /*!< Free frame count of each chunk. */
+    FrameDescriptor* descs_; /*!< Descriptor of each frame. */
+    AllocPolicy policy_;    /*!< AllocFrame() search policy. */
 }; // end PhysicalFrameAllocator
 } // end vmem
 } // end cosmo
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace cosmo
+{
+namespace vmem
+{
+/*!
+ * \class SummaryBitmap
+ * \brief A bitmap with a hierarchy of summary levels for fast searches.
+ *
+ * SummaryBitmap wraps a flat bitmap (level 0) in which a set bit marks an
+ * item as in use. Each summary level above it holds one bit per DWORD of
+ * the level below, set only when that DWORD is completely full. The top
+ * level is a single DWORD, so finding the first unset bit takes one bit scan
+ * per level (four levels cover 4 GiB of frames) no matter how full the
+ * bitmap is. SummaryBitmap does not own its storage: the caller hands it the
+ * level 0 bitmap and a scratch buffer of SummaryWords() DWORDs for the
+ * summaries.
+ */
+class SummaryBitmap
+{
+public:
+    static const uint32_t kBitsPerWord = 32; /*!< Bits per bitmap DWORD. */
+    static const int      kMaxLevels   = 6;  /*!< Max levels (level 0 included). */
+
+    SummaryBitmap();
+    ~SummaryBitmap() = default;
+
+    /* Allow default copy construction and assignment. */
+    SummaryBitmap(const SummaryBitmap&) = default;
+    SummaryBitmap& operator=(const SummaryBitmap&) = default;
+
+    /* Allow default move construction and assignment. */
+    SummaryBitmap(SummaryBitmap&&) = default;
+    SummaryBitmap& operator=(SummaryBitmap&&) = default;
+
+    /*!
+     * \brief Return the number of DWORDs needed to store \a nbits bits.
+     */
+    static size_t BitmapWords(size_t nbits)
+        { return (nbits + kBitsPerWord - 1) / kBitsPerWord; }
+
+    /*!
+     * \brief Return the number of summary DWORDs needed for \a nbits bits.
+     *
+     * The returned count excludes the level 0 bitmap itself.
+     */
+    static size_t SummaryWords(size_t nbits);
+
+    /*!
+     * \brief Attach the bitmap to its storage.
+     *
+     * The contents of \a bitmap are kept as is. Bits past \a nbits in the
+     * last DWORD are marked as in use so that they are never returned by a
+     * search. Call Rebuild() once \a bitmap has been populated.
+     *
+     * \param bitmap Level 0 bitmap of at least BitmapWords(\a nbits) DWORDs.
+     * \param summary Scratch space of at least SummaryWords(\a nbits) DWORDs.
+     * \param nbits Number of valid bits in \a bitmap.
+     */
+    void Init(uint32_t* bitmap, uint32_t* summary, size_t nbits);
+
+    /*!
+     * \brief Recompute every summary level from the level 0 bitmap.
+     */
+    void Rebuild();
+
+    /*!
+     * \brief Set bit \a bit and propagate a newly full DWORD upwards.
+     */
+    void Set(uint32_t bit);
+
+    /*!
+     * \brief Clear bit \a bit and propagate a no longer full DWORD upwards.
+     */
+    void Unset(uint32_t bit);
+
+    /*!
+     * \brief Set the \a count bits starting at \a bit.
+     *
+     * Each level is updated with range stores. Only the DWORDs that became
+     * full are propagated to the level above.
+     */
+    void SetRange(uint32_t bit, size_t count);
+
+    /*!
+     * \brief Clear the \a count bits starting at \a bit.
+     *
+     * Each level is updated with range stores. Every DWORD the range touches
+     * is no longer full, so the range above is simply the span of DWORDs.
+     */
+    void UnsetRange(uint32_t bit, size_t count);
+
+    /*!
+     * \brief Return \c true if bit \a bit is set.
+     */
+    bool Test(uint32_t bit) const
+        { return levels_[0][bit / kBitsPerWord] & (1U << (bit % kBitsPerWord)); }
+
+    /*!
+     * \brief Return the index of the first unset bit or -1 if all are set.
+     */
+    int FirstUnset() const;
+
+    /*!
+     * \brief Return the index of the first unset bit at or after \a bit.
+     *
+     * \return The index of the first unset bit in [\a bit, Size()) or -1 if
+     *         no such bit exists.
+     */
+    int NextUnset(uint32_t bit) const;
+
+    /*!
+     * \brief Return the length of the run of unset bits starting at \a bit.
+     *
+     * The run is measured a DWORD at a time and the result is capped at
+     * \a max_len.
+     */
+    uint32_t UnsetRunLength(uint32_t bit, uint32_t max_len) const;
+
+    /*!
+     * \brief Return the number of valid bits tracked by the bitmap.
+     */
+    size_t Size() const { return nbits_; }
+
+    /*!
+     * \brief Return a pointer to the level 0 bitmap.
+     */
+    uint32_t* Words() { return levels_[0]; }
+    const uint32_t* Words() const { return levels_[0]; }
+
+private:
+    uint32_t* levels_[kMaxLevels]; /*!< Level 0 bitmap followed by summaries. */
+    size_t    words_[kMaxLevels];  /*!< Number of DWORDs in each level. */
+    int       num_levels_;         /*!< Number of levels in use. */
+    size_t    nbits_;              /*!< Number of valid level 0 bits. */
+}; // end SummaryBitmap
+} // end vmem
+} // end cosmo
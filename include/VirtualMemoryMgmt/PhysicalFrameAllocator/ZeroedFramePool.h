@@ -0,0 +1,105 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace cosmo
+{
+namespace vmem
+{
+/*!
+ * \class ZeroedFramePool
+ * \brief A pool of page frames that were zeroed ahead of time.
+ *
+ * Frames for page tables and anonymous memory must be handed out zeroed.
+ * ZeroedFramePool moves that work off the allocation path: the kernel idle
+ * loop calls FillOne() to zero a frame with non-temporal stores (so the idle
+ * work does not evict hot cache lines) and AllocZeroedFrame() simply pops a
+ * frame from the pool. When the pool is empty AllocZeroedFrame() falls back
+ * to allocating and zeroing a frame synchronously with regular stores, since
+ * the caller is about to touch it anyway.
+ *
+ * Frames come from the PageMagazine and are zeroed through the physmap, see
+ * PhysToVirt(). The pool can only be used after VirtualMemoryManager::Init()
+ * installed the physmap.
+ */
+class ZeroedFramePool
+{
+public:
+    static const size_t kCapacity = 64; /*!< Max number of pooled frames. */
+
+    ~ZeroedFramePool() = default;
+
+    /* Disable copy construction and copy assignment. */
+    ZeroedFramePool(const ZeroedFramePool&) = delete;
+    ZeroedFramePool& operator=(const ZeroedFramePool&) = delete;
+
+    /* Disable move construction and move assignment. */
+    ZeroedFramePool(ZeroedFramePool&&) = delete;
+    ZeroedFramePool& operator=(ZeroedFramePool&&) = delete;
+
+    /*!
+     * \brief Return the singleton instance of ZeroedFramePool.
+     */
+    static ZeroedFramePool& GetInstance();
+
+    /*!
+     * \brief Allocate a zero filled page frame.
+     *
+     * \return The physical address of a zeroed frame or nullptr if the
+     *         PhysicalFrameAllocator is out of frames.
+     */
+    void* AllocZeroedFrame();
+
+    /*!
+     * \brief Zero one frame and add it to the pool.
+     *
+     * Meant to be called from the idle loop.
+     *
+     * \return \c true if a frame was added, \c false if the pool is full or
+     *         no frame could be allocated.
+     */
+    bool FillOne();
+
+    /*!
+     * \brief Zero the frame at physical address \a frame.
+     *
+     * Also used by other caches of zeroed frames, e.g. PageTableCache.
+     *
+     * \param frame Physical address of a #PhysicalFrameAllocator::kFrameSize
+     *              frame.
+     * \param non_temporal Use cache bypassing stores if supported.
+     */
+    void ZeroFrame(uint32_t frame, bool non_temporal);
+
+    /*!
+     * \brief Return the number of frames currently in the pool.
+     */
+    size_t GetCount() const { return count_; }
+
+    /*!
+     * \brief Return the number of allocations served from the pool.
+     */
+    uint32_t GetHits() const { return hits_; }
+
+    /*!
+     * \brief Return the number of allocations zeroed synchronously.
+     */
+    uint32_t GetMisses() const { return misses_; }
+
+    /*!
+     * \brief Return the percentage of allocations served from the pool.
+     */
+    uint32_t GetHitRate() const;
+
+private:
+    ZeroedFramePool();
+
+    void*    frames_[kCapacity]; /*!< Stack of zeroed frames. */
+    size_t   count_;             /*!< Number of pooled frames. */
+    uint32_t hits_;              /*!< Allocations served from the pool. */
+    uint32_t misses_;            /*!< Allocations zeroed synchronously. */
+    bool     has_movnti_;        /*!< CPU supports non-temporal stores. */
+}; // end ZeroedFramePool
+} // end vmem
+} // end cosmo
@@ -0,0 +1,327 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*!
+ * \brief Placement new.
+ *
+ * The kernel is built without the C++ standard library headers, so <new> is
+ * not available to provide it.
+ */
+inline void* operator new(size_t, void* ptr) noexcept { return ptr; }
+
+namespace cosmo
+{
+namespace vmem
+{
+/*!
+ * \struct SlabCacheStats
+ * \brief Utilization counters of a SlabCache.
+ */
+struct SlabCacheStats
+{
+    const char* name;             /*!< Name of the cache. */
+    size_t      object_size;      /*!< Object size after alignment. */
+    size_t      objects_per_slab; /*!< Objects that fit in one slab. */
+    size_t      slabs;            /*!< Slabs owned by the cache. */
+    size_t      objects_total;    /*!< Objects that fit in all slabs. */
+    size_t      objects_in_use;   /*!< Objects currently allocated. */
+    size_t      bytes;            /*!< Memory backing the slabs. */
+}; // end SlabCacheStats
+
+/*!
+ * \class SlabCache
+ * \brief A cache of equally sized objects carved out of slabs.
+ *
+ * A slab is one to four physically contiguous frames starting at a
+ * SlabAllocator::kSlabSpan aligned address. The slab header sits at the
+ * start of the slab, so the slab owning an object is found by masking the
+ * object's address. Free objects are chained through their first word.
+ * Objects past the highest one ever handed out are never linked, they are
+ * taken in order from the unused tail, which keeps slab creation O(1).
+ *
+ * Slabs are kept on a partial, a full and an empty list. Alloc() takes an
+ * object from the first partial slab and Free() returns it to its slab,
+ * moving the slab between lists as it fills up or drains. Both are O(1). At
+ * most one empty slab is kept per cache, further empty slabs are returned to
+ * the SlabAllocator.
+ *
+ * Objects are aligned to their size rounded up to a power of two, capped at
+ * #kCacheLine. Objects of a cache line or more therefore start on a cache
+ * line and smaller objects never straddle one.
+ */
+class SlabCache
+{
+public:
+    static const size_t kCacheLine     = 64;   /*!< CPU cache line size in bytes. */
+    static const size_t kMinObjectSize = 16;   /*!< Smallest object size. */
+    static const size_t kMaxObjectSize = 2048; /*!< Largest object size. */
+
+    /*!
+     * \brief Create an empty cache.
+     *
+     * \param name Name reported in the statistics.
+     * \param object_size Size of the objects in bytes, at most
+     *                    #kMaxObjectSize.
+     * \param align Minimum alignment of the objects in bytes, a power of two.
+     */
+    SlabCache(const char* name, size_t object_size, size_t align);
+
+    ~SlabCache() = default;
+
+    /* Disable copy construction and copy assignment. */
+    SlabCache(const SlabCache&) = delete;
+    SlabCache& operator=(const SlabCache&) = delete;
+
+    /* Disable move construction and move assignment. */
+    SlabCache(SlabCache&&) = delete;
+    SlabCache& operator=(SlabCache&&) = delete;
+
+    /*!
+     * \brief Allocate an object.
+     *
+     * \return An uninitialized object or nullptr if no slab could be added.
+     */
+    void* Alloc();
+
+    /*!
+     * \brief Return \a obj to its slab.
+     *
+     * \param obj Object previously returned by Alloc() on this cache.
+     */
+    void Free(void* obj);
+
+    /*!
+     * \brief Return the utilization counters of the cache.
+     */
+    SlabCacheStats GetStats() const;
+
+    /*!
+     * \brief Return the percentage of slab objects in use.
+     */
+    uint32_t GetUtilization() const;
+
+    /*!
+     * \brief Return the next cache registered with the SlabAllocator.
+     */
+    const SlabCache* GetNext() const { return next_; }
+
+private:
+    friend class SlabAllocator;
+
+    /*!
+     * \struct Slab
+     * \brief Header at the start of every slab.
+     */
+    struct Slab
+    {
+        Slab*      prev;      /*!< Previous slab on the same list. */
+        Slab*      next;      /*!< Next slab on the same list. */
+        SlabCache* cache;     /*!< Cache owning the slab. */
+        void*      free_list; /*!< Freed objects. */
+        uint16_t   in_use;    /*!< Allocated objects. */
+        uint16_t   unused;    /*!< Index of the first never allocated object. */
+    }; // end Slab
+
+    /*!
+     * \brief Return the header of the slab holding \a obj.
+     */
+    static Slab* SlabOf(void* obj);
+
+    /*!
+     * \brief Return the slab list matching the fill level of \a slab.
+     */
+    Slab** ListOf(const Slab* slab);
+
+    /*!
+     * \brief Insert \a slab at the head of \a list.
+     */
+    static void ListPush(Slab** list, Slab* slab);
+
+    /*!
+     * \brief Remove \a slab from \a list.
+     */
+    static void ListRemove(Slab** list, Slab* slab);
+
+    /*!
+     * \brief Add a new empty slab to the cache.
+     *
+     * \return The slab or nullptr if the SlabAllocator is out of memory.
+     */
+    Slab* Grow();
+
+    const char* name_;             /*!< Name reported in the statistics. */
+    size_t      object_size_;      /*!< Aligned object size. */
+    size_t      pages_per_slab_;   /*!< Pages backing one slab. */
+    size_t      objects_per_slab_; /*!< Objects in one slab. */
+    size_t      first_object_;     /*!< Offset of the first object in a slab. */
+    Slab*       partial_;          /*!< Slabs with free and used objects. */
+    Slab*       full_;             /*!< Slabs without free objects. */
+    Slab*       empty_;            /*!< Slabs without used objects. */
+    size_t      num_slabs_;        /*!< Slabs on all lists. */
+    size_t      in_use_;           /*!< Objects allocated from all slabs. */
+    SlabCache*  next_;             /*!< Next cache in the SlabAllocator registry. */
+}; // end SlabCache
+
+/*!
+ * \class SlabAllocator
+ * \brief The kernel heap.
+ *
+ * SlabAllocator serves kmalloc()/kfree() from power of two size classes
+ * between SlabCache::kMinObjectSize and SlabCache::kMaxObjectSize. Slabs are
+ * #kSlabSpan aligned runs of frames from the PhysicalFrameAllocator,
+ * accessed through the physmap. Slab frames are tagged #kFrameOwnerSlab in
+ * their FrameDescriptor, which lets Free() reject pointers that do not
+ * belong to the heap.
+ *
+ * Every SlabCache, including those behind ObjectCache, is registered so that
+ * the utilization of all caches can be walked starting at GetCaches(). This
+ * is a singleton class. It may only be used after
+ * VirtualMemoryManager::Init() installed the physmap.
+ */
+class SlabAllocator
+{
+public:
+    static const uint32_t kSlabSpan       = 0x4000; /*!< Max slab size and slab alignment. */
+    static const size_t   kNumSizeClasses = 8;      /*!< kmalloc() size classes. */
+
+    ~SlabAllocator() = default;
+
+    /* Disable copy construction and copy assignment. */
+    SlabAllocator(const SlabAllocator&) = delete;
+    SlabAllocator& operator=(const SlabAllocator&) = delete;
+
+    /* Disable move construction and move assignment. */
+    SlabAllocator(SlabAllocator&&) = delete;
+    SlabAllocator& operator=(SlabAllocator&&) = delete;
+
+    /*!
+     * \brief Return the singleton instance of SlabAllocator.
+     */
+    static SlabAllocator& GetInstance();
+
+    /*!
+     * \brief Allocate \a size bytes from the smallest fitting size class.
+     *
+     * \return The allocation or nullptr if \a size is 0, larger than
+     *         SlabCache::kMaxObjectSize or memory is exhausted.
+     */
+    void* Alloc(size_t size);
+
+    /*!
+     * \brief Free an object allocated from any SlabCache.
+     *
+     * nullptr and addresses outside of slabs are ignored.
+     */
+    void Free(void* ptr);
+
+    /*!
+     * \brief Add \a cache to the registry walked by GetCaches().
+     */
+    void RegisterCache(SlabCache* cache);
+
+    /*!
+     * \brief Return the first registered cache.
+     */
+    const SlabCache* GetCaches() const { return caches_; }
+
+private:
+    friend class SlabCache;
+
+    SlabAllocator();
+
+    /*!
+     * \brief Allocate a slab of \a pages contiguous frames.
+     *
+     * \return The physmap address of the slab or nullptr if out of frames.
+     */
+    void* AllocSlab(size_t pages);
+
+    /*!
+     * \brief Free the \a pages frames of the slab at \a slab.
+     */
+    void FreeSlab(void* slab, size_t pages);
+
+    SlabCache  size_caches_[kNumSizeClasses]; /*!< kmalloc() caches. */
+    SlabCache* caches_;                       /*!< Registered caches. */
+}; // end SlabAllocator
+
+/*!
+ * \brief Allocate \a size bytes from the kernel heap.
+ */
+void* kmalloc(size_t size);
+
+/*!
+ * \brief Free memory returned by kmalloc().
+ */
+void kfree(void* ptr);
+
+/*!
+ * \class ObjectCache
+ * \brief A typed SlabCache for frequently allocated kernel objects.
+ *
+ * Objects of type \a T get their own slabs instead of sharing a kmalloc()
+ * size class, so they are packed at their own size and alignment. Like
+ * other kernel singletons an ObjectCache is meant to be a function local
+ * static, it is never unregistered.
+ */
+template <typename T>
+class ObjectCache
+{
+public:
+    static_assert(sizeof(T) <= SlabCache::kMaxObjectSize,
+                  "object too large for a slab cache");
+
+    /*!
+     * \brief Create the cache and register it with the SlabAllocator.
+     */
+    explicit ObjectCache(const char* name) :
+        cache_(name, sizeof(T), alignof(T))
+    {
+        SlabAllocator::GetInstance().RegisterCache(&cache_);
+    }
+
+    ~ObjectCache() = default;
+
+    /* Disable copy construction and copy assignment. */
+    ObjectCache(const ObjectCache&) = delete;
+    ObjectCache& operator=(const ObjectCache&) = delete;
+
+    /* Disable move construction and move assignment. */
+    ObjectCache(ObjectCache&&) = delete;
+    ObjectCache& operator=(ObjectCache&&) = delete;
+
+    /*!
+     * \brief Allocate and construct a \a T from \a args.
+     *
+     * \return The object or nullptr if out of memory.
+     */
+    template <typename... Args>
+    T* New(Args&&... args)
+    {
+        void* obj = cache_.Alloc();
+        return obj ? new (obj) T(static_cast<Args&&>(args)...) : nullptr;
+    }
+
+    /*!
+     * \brief Destroy \a obj and return it to the cache.
+     */
+    void Delete(T* obj)
+    {
+        if (!obj)
+            return;
+        obj->~T();
+        cache_.Free(obj);
+    }
+
+    /*!
+     * \brief Return the underlying cache.
+     */
+    const SlabCache& GetCache() const { return cache_; }
+
+private:
+    SlabCache cache_; /*!< Cache holding the objects. */
+}; // end ObjectCache
+} // end vmem
+} // end cosmo
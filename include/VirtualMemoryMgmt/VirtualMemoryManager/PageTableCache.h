@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace cosmo
+{
+namespace vmem
+{
+/*!
+ * \class PageTableCache
+ * \brief A cache of zeroed frames reserved for page tables.
+ *
+ * Every page table must start out zeroed. The cache keeps a stack of frames
+ * that the idle loop zeroed ahead of time with FillOne(), separate from the
+ * ZeroedFramePool so that demand paging does not drain it. Alloc() hands out
+ * any number of tables at once: cached frames are used first and the rest
+ * is taken with a single call, from the PageMagazine for one table or as a
+ * PhysicalFrameAllocator batch for several, and zeroed on the spot. Frames
+ * are only zeroed once they are private, with interrupts enabled.
+ *
+ * Frames handed out are tagged #kFrameOwnerPageTable. They come from the
+ * normal zone and are zeroed through the physmap.
+ */
+class PageTableCache
+{
+public:
+    static const size_t kCapacity = 32; /*!< Max number of cached tables. */
+
+    ~PageTableCache() = default;
+
+    /* Disable copy construction and copy assignment. */
+    PageTableCache(const PageTableCache&) = delete;
+    PageTableCache& operator=(const PageTableCache&) = delete;
+
+    /* Disable move construction and move assignment. */
+    PageTableCache(PageTableCache&&) = delete;
+    PageTableCache& operator=(PageTableCache&&) = delete;
+
+    /*!
+     * \brief Return the singleton instance of PageTableCache.
+     */
+    static PageTableCache& GetInstance();
+
+    /*!
+     * \brief Take \a count zeroed page table frames.
+     *
+     * \param tables Output array of at least \a count entries, receives the
+     *               physical addresses of the frames.
+     * \param count Number of frames requested.
+     *
+     * \return \c true if all \a count frames were written to \a tables,
+     *         \c false if memory ran out. No frames are taken on failure.
+     */
+    bool Alloc(void** tables, size_t count);
+
+    /*!
+     * \brief Zero one frame and add it to the cache.
+     *
+     * Meant to be called from the idle loop.
+     *
+     * \return \c true if a frame was added, \c false if the cache is full or
+     *         no frame could be allocated.
+     */
+    bool FillOne();
+
+    /*!
+     * \brief Return the number of frames currently in the cache.
+     */
+    size_t GetCount() const { return count_; }
+
+    /*!
+     * \brief Return the number of tables served from the cache.
+     */
+    uint32_t GetHits() const { return hits_; }
+
+    /*!
+     * \brief Return the number of tables allocated and zeroed by Alloc().
+     */
+    uint32_t GetMisses() const { return misses_; }
+
+    /*!
+     * \brief Return the number of magazine or allocator calls made by
+     *        Alloc().
+     */
+    uint32_t GetBatches() const { return batches_; }
+
+private:
+    PageTableCache() : count_(0), hits_(0), misses_(0), batches_(0) { }
+
+    void*    frames_[kCapacity]; /*!< Stack of zeroed frames. */
+    size_t   count_;             /*!< Number of cached frames. */
+    uint32_t hits_;              /*!< Tables served from the cache. */
+    uint32_t misses_;            /*!< Tables zeroed by Alloc(). */
+    uint32_t batches_;           /*!< Allocator calls made by Alloc(). */
+}; // end PageTableCache
+} // end vmem
+} // end cosmo
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace cosmo
+{
+namespace vmem
+{
+/*!
+ * \class SwapSpace
+ * \brief Page sized slots that hold pages evicted by the page reclaimer.
+ *
+ * The backing store is a RAM stand-in for a swap device: Init() takes one
+ * physically contiguous run of frames from the normal zone and accesses it
+ * through the physmap. Pages are copied in and out with ReadPage() and
+ * WritePage(), so a disk backed store only needs to replace those two
+ * calls.
+ *
+ * Every slot has a reference count. A swapped out page referenced by the page
+ * tables of several address spaces holds one reference per page table entry,
+ * see DupSlot(). The slot is free again once FreeSlot() dropped the last
+ * one.
+ */
+class SwapSpace
+{
+public:
+    static const size_t kPageSize = 4096; /*!< Size of a slot in bytes. */
+    static const size_t kMaxSlots = 4096; /*!< Max number of slots (16 MiB). */
+
+    ~SwapSpace() = default;
+
+    /* Disable copy construction and copy assignment. */
+    SwapSpace(const SwapSpace&) = delete;
+    SwapSpace& operator=(const SwapSpace&) = delete;
+
+    /* Disable move construction and move assignment. */
+    SwapSpace(SwapSpace&&) = delete;
+    SwapSpace& operator=(SwapSpace&&) = delete;
+
+    /*!
+     * \brief Return the singleton instance of SwapSpace.
+     */
+    static SwapSpace& GetInstance();
+
+    /*!
+     * \brief Allocate the backing store for \a slots slots.
+     *
+     * \param slots Number of slots, at most #kMaxSlots.
+     *
+     * \return \c true on success, \c false if the store was already set up,
+     *         \a slots is out of range or no run of frames was available.
+     */
+    bool Init(size_t slots);
+
+    /*!
+     * \brief Return the number of slots.
+     */
+    size_t GetSlotCount() const { return slots_; }
+
+    /*!
+     * \brief Return the number of free slots.
+     */
+    size_t GetFreeSlots() const { return free_slots_; }
+
+    /*!
+     * \brief Take a free slot with a single reference.
+     *
+     * \return The slot number or -1 if every slot is in use.
+     */
+    int AllocSlot();
+
+    /*!
+     * \brief Add a reference to the used slot \a slot.
+     *
+     * \return \c false if \a slot is free or its reference count is
+     *         saturated.
+     */
+    bool DupSlot(uint32_t slot);
+
+    /*!
+     * \brief Drop a reference to \a slot, freeing it with the last one.
+     */
+    void FreeSlot(uint32_t slot);
+
+    /*!
+     * \brief Copy the page at \a page into \a slot.
+     */
+    void WritePage(uint32_t slot, const void* page);
+
+    /*!
+     * \brief Copy the contents of \a slot to the page at \a page.
+     */
+    void ReadPage(uint32_t slot, void* page) const;
+
+private:
+    SwapSpace() : store_(nullptr), slots_(0), free_slots_(0), next_(0),
+                  refcounts_() { }
+
+    uint8_t* store_;                 /*!< Physmap address of the backing store. */
+    size_t   slots_;                 /*!< Number of slots. */
+    size_t   free_slots_;            /*!< Number of free slots. */
+    size_t   next_;                  /*!< Slot where the next search starts. */
+    uint8_t  refcounts_[kMaxSlots];  /*!< References per slot, 0 if free. */
+}; // end SwapSpace
+} // end vmem
+} // end cosmo
@@ -0,0 +1,632 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "PhysicalFrameAllocator.h"
+#include "PhysMap.h"
+
+namespace cosmo
+{
+namespace vmem
+{
+#ifdef COSMO_PAE
+typedef uint64_t PageEntry; /*!< PAE page directory/table entry. */
+#else
+typedef uint32_t PageEntry; /*!< Page directory/table entry. */
+#endif
+
+/*!
+ * \enum PageFlags
+ * \brief x86 page directory and page table entry bits.
+ */
+enum PageFlags : uint32_t
+{
+    kPagePresent      = 1 << 0, /*!< Entry is valid. */
+    kPageWritable     = 1 << 1, /*!< Page is writable. */
+    kPageUser         = 1 << 2, /*!< Page is accessible from ring 3. */
+    kPageWriteThrough = 1 << 3, /*!< Write through caching. */
+    kPageCacheDisable = 1 << 4, /*!< Caching disabled. */
+    kPageAccessed     = 1 << 5, /*!< Set by the CPU on access. */
+    kPageDirty        = 1 << 6, /*!< Set by the CPU on write (PTE only). */
+    kPageLarge        = 1 << 7, /*!< 4 MiB page, 2 MiB with PAE (PDE only). */
+    kPageGlobal       = 1 << 8, /*!< Not flushed on CR3 reload. */
+    kPageCopyOnWrite  = 1 << 9, /*!< Software bit: shared, copy on write (PTE only). */
+    kPageSwapped      = 1 << 10 /*!< Software bit: not present, swap slot in bits 12+ (PTE only). */
+}; // end PageFlags
+
+/*!
+ * \enum PageFaultError
+ * \brief Bits of the error code pushed by the CPU on a page fault.
+ */
+enum PageFaultError : uint32_t
+{
+    kFaultProtection  = 1 << 0, /*!< Page was present, access was denied. */
+    kFaultWrite       = 1 << 1, /*!< Fault was caused by a write. */
+    kFaultUser        = 1 << 2, /*!< Fault happened in ring 3. */
+    kFaultReservedBit = 1 << 3, /*!< A reserved entry bit was set. */
+    kFaultFetch       = 1 << 4  /*!< Fault was caused by an instruction fetch. */
+}; // end PageFaultError
+
+/*!
+ * \struct PageFaultStats
+ * \brief Counters of the demand paging fault path.
+ *
+ * Cycle counts are measured with \c rdtsc from the entry of
+ * VirtualMemoryManager::HandlePageFault() to the installation of the new
+ * mapping and only cover resolved faults, copy-on-write faults included.
+ */
+struct PageFaultStats
+{
+    uint32_t resolved;     /*!< Faults resolved by mapping a frame. */
+    uint32_t rejected;     /*!< Faults passed on to the generic handler. */
+    uint32_t no_memory;    /*!< Faults that found no free frame. */
+    uint64_t total_cycles; /*!< Sum of the cycles spent on resolved faults. */
+    uint32_t min_cycles;   /*!< Fastest resolved fault. */
+    uint32_t max_cycles;   /*!< Slowest resolved fault. */
+    uint32_t cow_copied;   /*!< Copy-on-write faults that copied the page. */
+    uint32_t cow_reused;   /*!< Copy-on-write faults that took over the frame. */
+}; // end PageFaultStats
+
+/*!
+ * \struct ReclaimStats
+ * \brief Counters of the page reclaimer.
+ */
+struct ReclaimStats
+{
+    uint32_t scanned;    /*!< Pages visited by the clock hand. */
+    uint32_t evicted;    /*!< Pages written to swap and unmapped. */
+    uint32_t swapped_in; /*!< Pages read back from swap by the fault path. */
+    uint32_t direct;     /*!< Evictions done by the fault path itself. */
+}; // end ReclaimStats
+
+/*!
+ * \class TlbBatch
+ * \brief Collect TLB invalidations and issue them at once.
+ *
+ * Range operations Add() every page whose translation changed and Flush()
+ * once at the end. Up to #kMaxPages pages are invalidated one by one with
+ * \c invlpg. Past that a single CR3 reload is cheaper than the individual
+ * invalidations. A CR3 reload keeps global entries, so a batch holding
+ * kernel half pages uses cpu::FlushTlbGlobal() instead. The batch flushes
+ * itself when it goes out of scope.
+ */
+class TlbBatch
+{
+public:
+    static const size_t kMaxPages = 32; /*!< Max pages invalidated with invlpg. */
+
+    TlbBatch() : count_(0), full_(false), kernel_(false) { }
+    ~TlbBatch() { Flush(); }
+
+    /* Disable copy construction and copy assignment. */
+    TlbBatch(const TlbBatch&) = delete;
+    TlbBatch& operator=(const TlbBatch&) = delete;
+
+    /* Disable move construction and move assignment. */
+    TlbBatch(TlbBatch&&) = delete;
+    TlbBatch& operator=(TlbBatch&&) = delete;
+
+    /*!
+     * \brief Queue the invalidation of the page containing \a addr.
+     */
+    void Add(uint32_t addr);
+
+    /*!
+     * \brief Invalidate every queued page.
+     */
+    void Flush();
+
+private:
+    uint32_t pages_[kMaxPages]; /*!< Queued page addresses. */
+    size_t   count_;            /*!< Number of queued pages. */
+    bool     full_;             /*!< Too many pages, reload CR3 instead. */
+    bool     kernel_;           /*!< Kernel half (global) pages were queued. */
+}; // end TlbBatch
+
+/*!
+ * \class VirtualMemoryManager
+ * \brief Manage the kernel page directory and its 4 KiB page tables.
+ *
+ * The last page directory entry (#kRecursivePde) points back at the page
+ * directory itself. With that recursive entry every page table is visible at
+ * #kPageTables + (pde_index * #kPageSize) and the page directory at
+ * #kPageDirectory, so page table entries are edited in place without
+ * temporarily mapping page table frames. Init() also maps RAM linearly at
+ * kPhysMapBase with large pages, see PhysToVirt(). Page tables are taken
+ * from the PageTableCache, which keeps zeroed frames from the
+ * PhysicalFrameAllocator on hand.
+ *
+ * COSMO_PAE builds use 64-bit entries and 3-level tables. The loader sets up
+ * a PDPT with four page directories, one per GiB, that lie back to back in
+ * memory. The last four entries of the last directory point at the four
+ * directories, so the directories again form one array of PDEs at
+ * #kPageDirectory and the page tables one array of PTEs at #kPageTables.
+ * Large pages are 2 MiB instead of 4 MiB.
+ *
+ * The map/unmap/protect calls work on single pages and on ranges of pages.
+ * Range calls collect their TLB invalidations in a TlbBatch so the TLB is
+ * flushed once per call. This is a singleton class. Init() must be called
+ * before PhysicalFrameAllocator::Init() and the other calls after it.
+ *
+ * Regions registered with Reserve() are backed lazily: the page fault
+ * handler calls HandlePageFault(), which maps a zeroed frame on the first
+ * access to each page.
+ *
+ * Demand paged pages are reclaimed with a CLOCK scan. Once free memory drops
+ * below the low watermark, Reclaim() sweeps the regions: a page whose
+ * accessed bit is set gets it cleared and a second chance, a page found
+ * with the bit still clear is copied to the SwapSpace and its PTE replaced
+ * by a #kPageSwapped entry. The next access faults the page back in.
+ *
+ * The boot page directory is the first AddressSpace. CloneAddressSpace()
+ * derives new ones that share their user pages copy-on-write. The kernel
+ * half PDEs are the same in all address spaces: a page table added there
+ * is entered in every page directory.
+ */
+class VirtualMemoryManager
+{
+public:
+    static const uint32_t kPageSize        = 4096;       /*!< Size of a page in bytes. */
+#ifdef COSMO_PAE
+    static const uint32_t kEntriesPerTable = 512;        /*!< Entries per page table/directory. */
+    static const uint32_t kDirectoryPages  = 4;          /*!< Page directories, one per GiB. */
+    static const uint32_t kRecursivePde    = 2044;       /*!< First page directory self reference. */
+    static const uint32_t kPageTables      = 0xFF800000; /*!< Page tables via the recursive PDEs. */
+    static const uint32_t kPageDirectory   = 0xFFFFC000; /*!< Page directories via the recursive PDEs. */
+    static const uint32_t kLargePageSize   = 0x00200000; /*!< Size of a large page. */
+#else
+    static const uint32_t kEntriesPerTable = 1024;       /*!< Entries per page table/directory. */
+    static const uint32_t kDirectoryPages  = 1;          /*!< Number of page directories. */
+    static const uint32_t kRecursivePde    = 1023;       /*!< Page directory self reference. */
+    static const uint32_t kPageTables      = 0xFFC00000; /*!< Page tables via the recursive PDE. */
+    static const uint32_t kPageDirectory   = 0xFFFFF000; /*!< Page directory via the recursive PDE. */
+    static const uint32_t kLargePageSize   = 0x00400000; /*!< Size of a large page. */
+#endif
+    static const uint32_t kIoWindowBase    = 0xFC000000; /*!< Start of the MapIo() window. */
+    static const uint32_t kIoWindowSize    = 0x00400000; /*!< Size of the MapIo() window. */
+
+    /*!
+     * \struct AddressSpace
+     * \brief The page directories of one address space.
+     *
+     * The storage is provided by the caller, e.g. a process structure, and
+     * must stay valid until DestroyAddressSpace(). All address spaces are
+     * kept in a list headed by the boot address space.
+     */
+    struct AddressSpace
+    {
+        uint32_t      root;                       /*!< CR3 value: the page directory, with PAE the PDPT. */
+        uint32_t      directory[kDirectoryPages]; /*!< Physical addresses of the page directories. */
+        AddressSpace* next;                       /*!< Next address space in the list. */
+    }; // end AddressSpace
+
+    ~VirtualMemoryManager() = default;
+
+    /* Disable copy construction and copy assignment. */
+    VirtualMemoryManager(const VirtualMemoryManager&) = delete;
+    VirtualMemoryManager& operator=(const VirtualMemoryManager&) = delete;
+
+    /* Disable move construction and move assignment. */
+    VirtualMemoryManager(VirtualMemoryManager&&) = delete;
+    VirtualMemoryManager& operator=(VirtualMemoryManager&&) = delete;
+
+    /*!
+     * \brief Return the singleton instance of VirtualMemoryManager.
+     */
+    static VirtualMemoryManager& GetInstance();
+
+    /*!
+     * \brief Install the recursive mapping and the physmap in the boot page
+     *        directory.
+     *
+     * Init() allocates no frames. It runs before
+     * PhysicalFrameAllocator::Init() so that the allocator can place its
+     * metadata anywhere in the physmap. It also sets CR0.WP so that read-only
+     * pages are enforced in ring 0 too.
+     *
+     * \param kernel_desc Kernel descriptor used to locate the physical
+     *                    address of the boot page directory.
+     * \param mem_size_kb Size of physical memory in KB.
+     */
+    void Init(const KernelDescriptor& kernel_desc, size_t mem_size_kb);
+
+    /*!
+     * \brief Return the end of the physical memory mapped by the physmap.
+     */
+    uint32_t GetPhysMapEnd() const { return physmap_end_; }
+
+    /*!
+     * \brief Return \c true if kernel half mappings are global.
+     *
+     * Init() enables CR4.PGE when the CPU supports it and marks the kernel
+     * image and the physmap global. Pages mapped above kPhysMapBase later on
+     * are made global as well. Their translations then survive CR3 reloads,
+     * and changing them needs \c invlpg or cpu::FlushTlbGlobal().
+     */
+    bool HasGlobalPages() const { return global_pages_; }
+
+    /*!
+     * \brief Map the page at \a virt to the frame at \a phys.
+     *
+     * A page table is allocated if none covers \a virt yet. An existing
+     * mapping of \a virt is replaced.
+     *
+     * \param virt Page aligned virtual address.
+     * \param phys Page aligned physical address.
+     * \param flags Bitwise OR of #PageFlags. #kPagePresent is implied.
+     *
+     * \return \c true on success, \c false if \a virt lies in a large page,
+     *         the physmap or the recursive mapping, or no page table could
+     *         be allocated.
+     */
+    bool Map(uint32_t virt, PhysAddr phys, uint32_t flags);
+
+    /*!
+     * \brief Map \a count pages at \a virt to the frames at \a phys.
+     *
+     * The range is validated once up front. It is then mapped in steps of up
+     * to #kTableBatch page tables: the missing tables of a step are taken
+     * from the PageTableCache in one call, after which the PTEs are filled
+     * with a plain store loop. On failure every page mapped by the call is
+     * unmapped again, page tables allocated on the way are kept.
+     *
+     * \return \c true on success, \c false if the range is empty, wraps
+     *         around, touches a large page, the physmap or the recursive
+     *         mapping, or no page table could be allocated.
+     */
+    bool MapRange(uint32_t virt, PhysAddr phys, size_t count, uint32_t flags);
+
+    /*!
+     * \brief Map \a size bytes of device memory or firmware tables at
+     *        \a phys into the I/O window.
+     *
+     * The pages are mapped writable and uncached. The window at
+     * #kIoWindowBase is handed out in order and only UnmapIo() of the most
+     * recent mapping gives space back, so MapIo() is meant for the few
+     * mappings set up at boot, e.g. the APIC registers.
+     *
+     * \return The virtual address of \a phys or nullptr if \a size is 0,
+     *         the window is full or the mapping failed.
+     */
+    void* MapIo(PhysAddr phys, size_t size);
+
+    /*!
+     * \brief Remove the \a size bytes at \a virt mapped by MapIo().
+     *
+     * If this was the most recent mapping its addresses are handed out
+     * again, so a caller probing firmware tables can map, check and unmap
+     * them without using up the window. Addresses outside the window are
+     * ignored.
+     */
+    void UnmapIo(const void* virt, size_t size);
+
+    /*!
+     * \brief Remove the mapping of the page at \a virt.
+     *
+     * The mapped frame is not freed.
+     *
+     * \return \c true if a mapping was removed.
+     */
+    bool Unmap(uint32_t virt);
+
+    /*!
+     * \brief Remove the mappings of \a count pages at \a virt.
+     *
+     * Pages that are not mapped are skipped.
+     */
+    void UnmapRange(uint32_t virt, size_t count);
+
+    /*!
+     * \brief Replace the flags of the mapped page at \a virt.
+     *
+     * \return \c true on success, \c false if \a virt is not mapped.
+     */
+    bool Protect(uint32_t virt, uint32_t flags);
+
+    /*!
+     * \brief Replace the flags of \a count mapped pages at \a virt.
+     *
+     * \return \c false if any page in the range is not mapped. The pages
+     *         that are mapped are updated regardless.
+     */
+    bool ProtectRange(uint32_t virt, size_t count, uint32_t flags);
+
+    /*!
+     * \brief Translate \a virt to a physical address.
+     *
+     * \param virt Virtual address.
+     * \param phys Set to the physical address on success.
+     *
+     * \return \c true if \a virt is mapped.
+     */
+    bool Translate(uint32_t virt, PhysAddr* phys) const;
+
+    /*!
+     * \brief Reserve \a count pages at \a virt for demand paging.
+     *
+     * No memory is committed. The first access to a page of the region
+     * faults and HandlePageFault() maps a zeroed frame with \a flags.
+     *
+     * \param virt Page aligned virtual address.
+     * \param count Number of pages in the region.
+     * \param flags Bitwise OR of #PageFlags used for the demand mappings.
+     *
+     * \return \c true on success, \c false if the region is empty, overlaps
+     *         another region, the physmap or the recursive mapping, or
+     *         all #kMaxRegions slots are in use.
+     */
+    bool Reserve(uint32_t virt, size_t count, uint32_t flags);
+
+    /*!
+     * \brief Release the region starting at \a virt.
+     *
+     * Every page that was faulted in is unmapped and its frame reference is
+     * dropped.
+     *
+     * \return \c true if a region started at \a virt.
+     */
+    bool Release(uint32_t virt);
+
+    /*!
+     * \brief Resolve a page fault in a reserved region.
+     *
+     * Called from the #PF handler with interrupts disabled, before any
+     * logging. Not-present faults inside a region whose flags allow the
+     * access and write faults on #kPageCopyOnWrite pages are resolved. A
+     * #kPageSwapped page is read back from the SwapSpace. If no frame is
+     * free, the fault evicts a page itself.
+     * Everything else is left to the generic handler.
+     *
+     * \param fault_addr Faulting address (CR2).
+     * \param err_code Error code pushed by the CPU, see #PageFaultError.
+     *
+     * \return \c true if a frame was mapped and the access can be retried.
+     */
+    bool HandlePageFault(uint32_t fault_addr, uint32_t err_code);
+
+    /*!
+     * \brief Return the address space currently loaded in CR3.
+     */
+    AddressSpace* GetAddressSpace() const { return current_; }
+
+    /*!
+     * \brief Clone the current address space into \a child.
+     *
+     * Only the page tables of the user half are copied, the kernel half PDEs
+     * are shared. Every user frame with a reference count gains a reference.
+     * Writable user pages turn read-only and #kPageCopyOnWrite in both
+     * address spaces. The first write to such a page faults and
+     * HandlePageFault() gives the writer a private copy, or hands the frame
+     * over unchanged once no other reference is left. Cloning thus costs
+     * O(page tables), not O(resident memory).
+     *
+     * \param child Storage for the new address space.
+     *
+     * \return \c true on success, \c false if memory ran out or a frame is
+     *         referenced too often. No memory stays allocated on failure.
+     */
+    bool CloneAddressSpace(AddressSpace* child);
+
+    /*!
+     * \brief Load \a space into CR3.
+     */
+    void SwitchAddressSpace(AddressSpace* space);
+
+    /*!
+     * \brief Free the user half page tables and the page directories of
+     *        \a space.
+     *
+     * Every frame mapped in the user half of \a space loses a reference.
+     *
+     * \return \c false if \a space is the current or the boot address space.
+     */
+    bool DestroyAddressSpace(AddressSpace* space);
+
+    /*!
+     * \brief Return the demand paging counters.
+     */
+    const PageFaultStats& GetFaultStats() const { return fault_stats_; }
+
+    /*!
+     * \brief Set the free frame watermarks of the page reclaimer.
+     *
+     * Reclaim() starts evicting once fewer than \a low frames are free and
+     * keeps going until \a high frames are free. Both default to 0, which
+     * disables background reclaim.
+     */
+    void SetReclaimWatermarks(size_t low, size_t high);
+
+    /*!
+     * \brief Advance the reclaim clock if free memory is short.
+     *
+     * Meant to be called from the idle loop so that page faults find free
+     * frames instead of having to evict pages themselves. At most
+     * #kScanBatch pages are visited per call.
+     *
+     * \return The number of pages evicted.
+     */
+    size_t Reclaim();
+
+    /*!
+     * \brief Return the page reclaimer counters.
+     */
+    const ReclaimStats& GetReclaimStats() const { return reclaim_stats_; }
+
+private:
+#ifdef COSMO_PAE
+    static const PageEntry kFrameMask = 0x000FFFFFFFFFF000ULL; /*!< Frame address bits of an entry. */
+    static const uint32_t  kPdeShift  = 21;                    /*!< Virtual address bits per PDE. */
+#else
+    static const PageEntry kFrameMask = 0xFFFFF000;            /*!< Frame address bits of an entry. */
+    static const uint32_t  kPdeShift  = 22;                    /*!< Virtual address bits per PDE. */
+#endif
+    static const uint32_t  kPageMask   = ~(kPageSize - 1);     /*!< Page bits of a virtual address. */
+    static const uint32_t  kFlagsMask  = 0x00000FFF;           /*!< Flag bits of an entry. */
+    static const size_t    kMaxRegions = 16;                   /*!< Max demand paged regions. */
+    static const size_t    kTableBatch = 32;                   /*!< Max page tables set up per MapRange() step. */
+    static const uint32_t  kKernelPde  = kPhysMapBase >> kPdeShift; /*!< First PDE of the kernel half. */
+    static const size_t    kScanBatch  = 256;                  /*!< Max pages visited per Reclaim() call. */
+
+    /*!
+     * \struct Region
+     * \brief A demand paged virtual address range [start, end).
+     */
+    struct Region
+    {
+        uint32_t start; /*!< First page of the region. */
+        uint32_t end;   /*!< First page past the region, 0 marks a free slot. */
+        uint32_t flags; /*!< #PageFlags of the demand mappings. */
+    }; // end Region
+
+    VirtualMemoryManager() :
+        physmap_end_(0), global_pages_(false), regions_(), last_region_(0),
+        fault_stats_{0, 0, 0, 0, UINT32_MAX, 0, 0, 0}, kernel_space_(),
+        current_(&kernel_space_), clock_region_(0), clock_page_(0),
+        reclaim_low_(0), reclaim_high_(0), reclaiming_(false),
+        reclaim_stats_(), io_next_(kIoWindowBase) { }
+
+    /*!
+     * \brief Return the page directory entry covering \a virt.
+     */
+    static PageEntry* Pde(uint32_t virt)
+        { return reinterpret_cast<PageEntry*>(kPageDirectory) + (virt >> kPdeShift); }
+
+    /*!
+     * \brief Return the page table entry of \a virt.
+     *
+     * Through the recursive mapping all page tables form one contiguous
+     * array of entries. The entry is only accessible if its PDE is present.
+     */
+    static PageEntry* Pte(uint32_t virt)
+        { return reinterpret_cast<PageEntry*>(kPageTables) + (virt >> 12); }
+
+    /*!
+     * \brief Return the present 4 KiB page table entry of \a virt or nullptr.
+     */
+    static PageEntry* MappedPte(uint32_t virt);
+
+    /*!
+     * \brief Return PDE \a index of \a space through the physmap.
+     */
+    static PageEntry* DirectoryEntry(const AddressSpace& space, uint32_t index);
+
+    /*!
+     * \brief Store \a value in the page directory or table entry \a entry.
+     *
+     * A PAE entry takes two 32-bit stores. The present bit is cleared first
+     * and set last so the MMU never walks a half written entry.
+     */
+    static void WriteEntry(PageEntry* entry, PageEntry value);
+
+    /*!
+     * \brief Return the PTE flags for mapping \a virt with \a flags.
+     *
+     * Adds #kPagePresent and, for kernel half pages, #kPageGlobal.
+     */
+    uint32_t PageFlags(uint32_t virt, uint32_t flags) const;
+
+    /*!
+     * \brief Make sure page tables back PDEs \a first to \a last.
+     *
+     * All missing tables are taken from the PageTableCache in a single
+     * call. Nothing is changed if any PDE maps a large page or the tables
+     * can't be allocated.
+     *
+     * \param first Index of the first PDE.
+     * \param last Index of the last PDE, at most #kTableBatch - 1 past
+     *             \a first.
+     * \param flags Flags of the mappings about to be created.
+     * \param tlb Batch collecting TLB invalidations.
+     */
+    bool EnsurePageTables(uint32_t first, uint32_t last, uint32_t flags,
+                          TlbBatch& tlb);
+
+    /*!
+     * \brief Copy kernel half PDE \a index to every other address space.
+     */
+    void SyncKernelPde(uint32_t index);
+
+    /*!
+     * \brief Fill \a table with the PTEs of user half PDE \a index.
+     *
+     * Takes a reference on each frame and turns writable pages
+     * copy-on-write in the current address space.
+     *
+     * \return \c false if a frame's reference count is saturated.
+     */
+    bool CloneTable(uint32_t index, PageEntry* table, TlbBatch& tlb);
+
+    /*!
+     * \brief Free the user half page tables and the directories of \a space,
+     *        dropping the references of the mapped frames.
+     */
+    void FreeAddressSpace(const AddressSpace& space);
+
+    /*!
+     * \brief Resolve a write fault on the copy-on-write page \a page.
+     */
+    bool ResolveCopyOnWrite(uint32_t page, uint32_t err_code);
+
+    /*!
+     * \brief Return the number of free frames in all zones.
+     */
+    static size_t FreeFrames();
+
+    /*!
+     * \brief Move the clock hand to the next page of a region.
+     *
+     * \return \c false if there are no regions.
+     */
+    bool AdvanceClock();
+
+    /*!
+     * \brief Visit up to \a max_scan pages and evict up to \a target of
+     *        them.
+     *
+     * \return The number of pages evicted.
+     */
+    size_t ScanClock(size_t max_scan, size_t target);
+
+    /*!
+     * \brief Count a resolved fault that started at TSC value \a start.
+     */
+    void CountResolved(uint64_t start);
+
+    /*!
+     * \brief Map a single page, queueing the invalidation in \a tlb.
+     */
+    bool MapPage(uint32_t virt, PhysAddr phys, uint32_t flags, TlbBatch& tlb);
+
+    /*!
+     * \brief Unmap a single page, queueing the invalidation in \a tlb.
+     */
+    bool UnmapPage(uint32_t virt, TlbBatch& tlb);
+
+    /*!
+     * \brief Change the flags of a single page, queueing the invalidation.
+     */
+    bool ProtectPage(uint32_t virt, uint32_t flags, TlbBatch& tlb);
+
+    /*!
+     * \brief Return the region containing \a virt or nullptr.
+     */
+    Region* FindRegion(uint32_t virt);
+
+    uint32_t       physmap_end_;          /*!< Physical end of the physmap. */
+    bool           global_pages_;         /*!< Kernel half mappings are global. */
+    Region         regions_[kMaxRegions]; /*!< Demand paged regions. */
+    size_t         last_region_;          /*!< Slot of the last faulting region. */
+    PageFaultStats fault_stats_;          /*!< Demand paging counters. */
+    AddressSpace   kernel_space_;         /*!< Boot address space, head of the list. */
+    AddressSpace*  current_;              /*!< Address space loaded in CR3. */
+    size_t         clock_region_;         /*!< Region under the clock hand. */
+    uint32_t       clock_page_;           /*!< Page under the clock hand. */
+    size_t         reclaim_low_;          /*!< Free frames that start reclaim. */
+    size_t         reclaim_high_;         /*!< Free frames that stop reclaim. */
+    bool           reclaiming_;           /*!< Reclaim runs until #reclaim_high_. */
+    ReclaimStats   reclaim_stats_;        /*!< Page reclaimer counters. */
+    uint32_t       io_next_;              /*!< Next free address in the I/O window. */
+}; // end VirtualMemoryManager
+} // end vmem
+} // end cosmo
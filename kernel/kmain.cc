@@ -1,14 +1,25 @@
 #include <stdint.h>
 #include <string.h>
 
+#include "Cpu.h"
 #include "Logger.h"
 #include "FrameBuffer.h"
 #include "multiboot.h"
 #include "GlobalDescriptorTable.h"
 #include "InterruptDescriptorTable.h"
 #include "InterruptHandler.h"
+#include "IRQ/Keyboard/KeyboardIrq.h"
+#include "IrqChip.h"
+#include "SoftIrq.h"
 #include "ProgrammableInterruptController.h"
 #include "PhysicalFrameAllocator.h"
+#include "ZeroedFramePool.h"
+#include "PageTableCache.h"
+#include "VirtualMemoryManager.h"
+#include "SwapSpace.h"
+#include "PhysMap.h"
+#include "BootModules.h"
+#include "Ramdisk.h"
 
 void Halt()
 {
@@ -16,6 +27,45 @@ void Halt()
         __asm__ volatile("hlt");
 }
 
+/* Swap slots backing the page reclaimer (4 MiB). */
+static const size_t kSwapSlots = 1024;
+
+void Idle()
+{
+    auto& vmm         = cosmo::vmem::VirtualMemoryManager::GetInstance();
+    auto& zero_pool   = cosmo::vmem::ZeroedFramePool::GetInstance();
+    auto& table_cache = cosmo::vmem::PageTableCache::GetInstance();
+    auto& softirq     = cosmo::interrupt::SoftIrq::GetInstance();
+    auto& fb          = cosmo::FrameBuffer::GetInstance();
+    for (;;) {
+        /* Run the bottom halves an interrupt left behind and echo the keys
+           typed so far. Then use idle time to keep free memory above the
+           reclaim watermark and to pre-zero frames. */
+        bool busy = softirq.Run();
+
+        cosmo::interrupt::irq::kbd::KeyEvent event;
+        while (cosmo::interrupt::irq::kbd::PollEvent(&event)) {
+            if (event.pressed && event.ascii)
+                fb.PrintChar(event.ascii);
+        }
+
+        busy = (0 != vmm.Reclaim()) || busy;
+        busy = zero_pool.FillOne() || busy;
+        busy = table_cache.FillOne() || busy;
+        if (busy)
+            continue;
+
+        /* Sleep until the next interrupt once there is nothing left to do.
+           sti only takes effect after the hlt started, so an interrupt that
+           leaves work behind after the check still wakes the loop up. */
+        cosmo::cpu::DisableInterrupts();
+        if (!softirq.IsPending() && !cosmo::interrupt::irq::kbd::HasEvents())
+            __asm__ volatile("sti\n\thlt" ::: "memory");
+        else
+            cosmo::cpu::EnableInterrupts();
+    }
+}
+
 void PrintLogo()
 {
     auto& fb = cosmo::FrameBuffer::GetInstance();
@@ -74,21 +124,99 @@ void InitPic()
         cosmo::pic::SetMask(i);
     }
 
-    /* Clear the mask on the keyboard IRQ. */
-    cosmo::pic::ClearMask(cosmo::interrupt::Irq::kKeyboard);
+    /* Drivers unmask their lines when they register an IRQ handler. */
+    if (!cosmo::interrupt::irq::kbd::Init())
+        LOG_ERROR("error, unable to register the keyboard IRQ handler\n");
+}
+
+void InitIrqChip()
+{
+    /* The PICs deliver the IRQs until the frame allocator is up, the APIC
+       registers and the ACPI tables need page mappings. */
+    if (cosmo::interrupt::IrqChip::GetInstance().UseApic())
+        LOG_INFO("IRQs are delivered by the APIC\n");
+    else
+        LOG_INFO("No APIC found, IRQs stay on the 8259 PIC\n");
 }
 
 void InitPhysicalFrameAllocator(const multiboot_info_t* mboot_hdr,
-                                const cosmo::vmem::KernelDescriptor& kernel_desc)
+                                const cosmo::vmem::KernelDescriptor& kernel_desc,
+                                size_t mem_size_kb)
 {
-    size_t mem_size_kb = 1024 + mboot_hdr->mem_upper;
+    /* GRUB loads modules right behind the kernel. Place the allocator
+       metadata past the modules, their list and their command lines so
+       that they can be used in place. */
+    uint32_t meta_addr = kernel_desc.kernel_physical_end;
+    if ((mboot_hdr->flags & MULTIBOOT_INFO_MODS) && mboot_hdr->mods_count) {
+        const multiboot_module_t* mods =
+            static_cast<const multiboot_module_t*>(
+                cosmo::vmem::PhysToVirt(mboot_hdr->mods_addr));
+        uint32_t end = mboot_hdr->mods_addr +
+                       (mboot_hdr->mods_count * sizeof(multiboot_module_t));
+        if (end > meta_addr)
+            meta_addr = end;
+
+        for (uint32_t i = 0; i < mboot_hdr->mods_count; ++i) {
+            if (mods[i].mod_end > meta_addr)
+                meta_addr = mods[i].mod_end;
+            if (mods[i].cmdline) {
+                end = mods[i].cmdline + strlen(static_cast<const char*>(
+                          cosmo::vmem::PhysToVirt(mods[i].cmdline))) + 1;
+                if (end > meta_addr)
+                    meta_addr = end;
+            }
+        }
+        meta_addr = (meta_addr + 0xFFF) & ~0xFFF;
+    }
+
     auto& falloc = cosmo::vmem::PhysicalFrameAllocator::GetInstance();
     falloc.Init(mboot_hdr,
-                kernel_desc.kernel_physical_end,
+                meta_addr,
                 mem_size_kb,
                 kernel_desc);
 }
 
+void LoadInitrd()
+{
+    auto& modules = cosmo::boot::BootModules::GetInstance();
+    int   index   = modules.FindModule("initrd");
+    if (-1 == index) {
+        LOG_WARN("No initrd module loaded\n");
+        return;
+    }
+
+    const cosmo::boot::BootModule* module = modules.GetModule(index);
+    const void* image = modules.Map(index);
+    cosmo::Ramdisk ramdisk;
+    if (!image || !ramdisk.Init(image, module->phys_end - module->phys_start)) {
+        LOG_ERROR("error, unable to open the initrd\n");
+        return;
+    }
+
+    size_t             cursor = 0;
+    cosmo::RamdiskFile file;
+    while (ramdisk.Next(&cursor, &file)) {
+        LOG_INFO("initrd: %s (%d bytes)\n", file.path,
+                 static_cast<int>(file.size));
+    }
+}
+
+void InitSwap()
+{
+    auto& swap = cosmo::vmem::SwapSpace::GetInstance();
+    if (!swap.Init(kSwapSlots)) {
+        LOG_WARN("No memory for the swap space, page reclaim disabled\n");
+        return;
+    }
+
+    /* Evict pages once less than 1/64 of memory is free, until 1/32 is. */
+    auto&  falloc = cosmo::vmem::PhysicalFrameAllocator::GetInstance();
+    size_t frames = falloc.GetMaxFrames();
+    cosmo::vmem::VirtualMemoryManager::GetInstance().SetReclaimWatermarks(
+        frames / 64, frames / 32);
+    LOG_INFO("Swap space: %d slots\n", static_cast<int>(swap.GetSlotCount()));
+}
+
 extern "C" int kernel_main(uint32_t kernel_physical_start,
                            uint32_t kernel_physical_end,
                            uint32_t kernel_virtual_start,
@@ -123,12 +251,14 @@ extern "C" int kernel_main(uint32_t kernel_physical_start,
     LOG_INFO("Initializing the IDT...\n");
     InitIdt();
     LOG_INFO("IDT setup succeeded!\n");
+#ifdef COSMO_IRQ_BENCH
+    cosmo::interrupt::RunIrqBench();
+#endif
 
     LOG_INFO("Initializing PIC...\n");
     InitPic();
     LOG_INFO("PIC setup succeeded!\n");
 
-    LOG_INFO("Initializing Physical Frame Allocator...\n");
     struct cosmo::vmem::KernelDescriptor kernel_desc = {
         .kernel_physical_start = kernel_physical_start,
         .kernel_physical_end   = kernel_physical_end,
@@ -136,11 +266,40 @@ extern "C" int kernel_main(uint32_t kernel_physical_start,
         .kernel_virtual_end    = kernel_virtual_end,
         .kernel_virtual_base   = kernel_virtual_base
     };
-    InitPhysicalFrameAllocator(mboot_hdr, kernel_desc);
+
+    size_t mem_size_kb = cosmo::vmem::PhysicalFrameAllocator::GetMemorySize(
+        mboot_hdr, kernel_virtual_base);
+    LOG_INFO("Physical memory size: %d KB\n", static_cast<int>(mem_size_kb));
+
+    /* The physmap goes first, the frame allocator and the module list may
+       lie anywhere in RAM. */
+    LOG_INFO("Initializing Virtual Memory Manager...\n");
+    auto& vmm = cosmo::vmem::VirtualMemoryManager::GetInstance();
+    vmm.Init(kernel_desc, mem_size_kb);
+    LOG_INFO("Virtual Memory Manager setup succeeded!\n");
+    LOG_INFO("Physmap covers physical memory up to %X\n",
+             static_cast<unsigned int>(vmm.GetPhysMapEnd()));
+    if (vmm.HasGlobalPages())
+        LOG_INFO("Kernel mappings are global (CR4.PGE)\n");
+
+    LOG_INFO("Initializing Physical Frame Allocator...\n");
+    InitPhysicalFrameAllocator(mboot_hdr, kernel_desc, mem_size_kb);
     LOG_INFO("Physical Frame Allocator setup succeeded!\n");
+#ifdef COSMO_PAE
+    LOG_INFO("PAE paging enabled, %d frames above 4 GiB\n",
+             static_cast<int>(
+                 cosmo::vmem::PhysicalFrameAllocator::GetInstance().GetZoneFrames(
+                     cosmo::vmem::PhysicalFrameAllocator::Zone::kPae)));
+#endif
+
+    InitIrqChip();
+
+    cosmo::boot::BootModules::GetInstance().Init(mboot_hdr);
+    LoadInitrd();
+    InitSwap();
 
     /* Keep the kernel from exiting. */
-    Halt();
+    Idle();
 
     /* Should never make it here... */
     return 0xDEADBEEF;
@@ -8,18 +8,27 @@ Help()
 {
     echo "Build the cosmo OS kernel ELF."
     echo
-    echo "usage: build_cosmo.sh [d|h]"
+    echo "usage: build_cosmo.sh [b|d|i|p|h]"
     echo "options:"
+    echo "b    Use the buddy physical frame allocator backend (default bitmap)."
     echo "d    Build project documentation (default OFF)."
+    echo "i    Log the cycle cost of the interrupt entry paths at boot (default OFF)."
+    echo "p    Use PAE paging to reach memory above 4 GiB (default OFF)."
     echo "h    Print this help message."
 }
 
 BUILD_DOC="OFF"
+FRAME_ALLOCATOR="bitmap"
+IRQ_BENCH="OFF"
+PAE="OFF"
 
-while getopts ":hd" flag
+while getopts ":hbdip" flag
 do
     case "${flag}" in
+        b) FRAME_ALLOCATOR="buddy";;
         d) BUILD_DOC="ON";;
+        i) IRQ_BENCH="ON";;
+        p) PAE="ON";;
         h) Help
            exit;;
        \?) echo "Error: Invalid option"
@@ -41,7 +50,10 @@ fi
 pushd $COSMO_BUILD_DIR
     cmake                                                     \
         -DCMAKE_TOOLCHAIN_FILE=${COSMO_PROJECT_PATH}/cmake/i686-elf-gcc.cmake    \
-        -DBUILD_DOC=${BUILD_DOC} ../                       && \
+        -DBUILD_DOC=${BUILD_DOC}                               \
+        -DCOSMO_FRAME_ALLOCATOR=${FRAME_ALLOCATOR}             \
+        -DCOSMO_IRQ_BENCH=${IRQ_BENCH}                         \
+        -DCOSMO_PAE=${PAE} ../                                 && \
     make all                                               &&
     make install
 
@@ -58,6 +58,13 @@ then
     mkdir -pv $COSMO_BIN_DIR
 fi
 
+# Pack cosmo/initrd into the ustar archive GRUB loads as the "initrd" module.
+if ! tar --format=ustar -C ../initrd -cf ../iso/boot/initrd.tar .
+then
+    echo -e "${LRED}Unable to create initrd.tar.${NC}"
+    exit 1
+fi
+
 # Run grub-mkrescue on the contents of cosmo/iso. The output is the ISO image
 # cosmo/bin/cosmo.iso.
 if ${COSMO_GRUB_MKRESCUE} \
@@ -0,0 +1,284 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "Acpi.h"
+#include "PhysMap.h"
+#include "VirtualMemoryManager.h"
+
+namespace cosmo
+{
+namespace acpi
+{
+/*!
+ * \struct Rsdp
+ * \brief ACPI 1.0 Root System Description Pointer.
+ */
+struct __attribute__((packed)) Rsdp
+{
+    char     signature[8]; /*!< "RSD PTR ". */
+    uint8_t  checksum;     /*!< Bytes of the structure sum to 0. */
+    char     oem_id[6];    /*!< OEM identifier. */
+    uint8_t  revision;     /*!< 0 for ACPI 1.0, 2 for later versions. */
+    uint32_t rsdt_phys;    /*!< Physical address of the RSDT. */
+}; // end Rsdp
+
+/*!
+ * \struct SdtHeader
+ * \brief Header shared by all ACPI system description tables.
+ */
+struct __attribute__((packed)) SdtHeader
+{
+    char     signature[4];     /*!< Table signature, e.g. "APIC". */
+    uint32_t length;           /*!< Length of the table including the header. */
+    uint8_t  revision;         /*!< Table revision. */
+    uint8_t  checksum;         /*!< Bytes of the table sum to 0. */
+    char     oem_id[6];        /*!< OEM identifier. */
+    char     oem_table_id[8];  /*!< OEM table identifier. */
+    uint32_t oem_revision;     /*!< OEM revision. */
+    uint32_t creator_id;       /*!< Vendor ID of the table compiler. */
+    uint32_t creator_revision; /*!< Revision of the table compiler. */
+}; // end SdtHeader
+
+/*!
+ * \struct MadtHeader
+ * \brief Multiple APIC Description Table, followed by its entries.
+ */
+struct __attribute__((packed)) MadtHeader
+{
+    SdtHeader header;     /*!< Signature "APIC". */
+    uint32_t  lapic_phys; /*!< Physical address of the local APIC. */
+    uint32_t  flags;      /*!< Bit 0: 8259 PICs are installed too. */
+}; // end MadtHeader
+
+/*!
+ * \struct MadtIoApic
+ * \brief MADT entry type 1.
+ */
+struct __attribute__((packed)) MadtIoApic
+{
+    uint8_t  type;     /*!< 1. */
+    uint8_t  length;   /*!< 12. */
+    uint8_t  id;       /*!< IO-APIC ID. */
+    uint8_t  reserved; /*!< Zero. */
+    uint32_t phys;     /*!< Physical address of the registers. */
+    uint32_t gsi_base; /*!< GSI of the first pin. */
+}; // end MadtIoApic
+
+/*!
+ * \struct MadtOverride
+ * \brief MADT entry type 2, an ISA IRQ that is not identity mapped.
+ */
+struct __attribute__((packed)) MadtOverride
+{
+    uint8_t  type;   /*!< 2. */
+    uint8_t  length; /*!< 10. */
+    uint8_t  bus;    /*!< 0, ISA. */
+    uint8_t  source; /*!< ISA IRQ. */
+    uint32_t gsi;    /*!< GSI the IRQ is wired to. */
+    uint16_t flags;  /*!< #IntiFlags. */
+}; // end MadtOverride
+
+static const uint32_t kEbdaSegmentPtr = 0x40E;   /*!< BDA word holding the EBDA segment. */
+static const uint32_t kBiosAreaStart  = 0xE0000; /*!< BIOS read-only area. */
+static const uint32_t kBiosAreaEnd    = 0x100000;
+static const uint32_t kMaxTableLength = 0x10000; /*!< Sanity limit on table lengths. */
+static const uint8_t  kMadtIoApic     = 1;
+static const uint8_t  kMadtOverride   = 2;
+static const uint32_t kMadtPcatCompat = 1 << 0;
+
+/*!
+ * \brief Return \c true if the \a size bytes at \a data sum to 0.
+ */
+static bool ChecksumOk(const void* data, size_t size)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint8_t        sum   = 0;
+    for (size_t i = 0; i < size; ++i)
+        sum += bytes[i];
+    return 0 == sum;
+}
+
+/*!
+ * \brief Return a mapping of the \a size bytes at physical address \a phys.
+ */
+static const void* MapPhys(uint32_t phys, size_t size)
+{
+    auto&    vmm = vmem::VirtualMemoryManager::GetInstance();
+    uint32_t end = vmm.GetPhysMapEnd();
+    if ((phys < end) && (size <= (end - phys)))
+        return vmem::PhysToVirt(phys);
+    return vmm.MapIo(phys, size);
+}
+
+/*!
+ * \brief Drop a mapping returned by MapPhys().
+ *
+ * Physmap addresses lie below the I/O window and are left alone.
+ */
+static void UnmapPhys(const void* virt, size_t size)
+{
+    vmem::VirtualMemoryManager::GetInstance().UnmapIo(virt, size);
+}
+
+/*!
+ * \brief Drop the mapping of a table returned by MapTable().
+ */
+static void UnmapTable(const SdtHeader* table)
+{
+    UnmapPhys(table, table->length);
+}
+
+/*!
+ * \brief Map the table at \a phys and return it if its signature is
+ *        \a signature and its checksum is valid.
+ *
+ * The header is mapped together with the rest of its page, which holds
+ * most tables completely. Only longer tables are mapped a second time.
+ * Rejected tables are unmapped again, so probing the RSDT entries does not
+ * use up the I/O window.
+ */
+static const SdtHeader* MapTable(uint32_t phys, const char* signature)
+{
+    const uint32_t kPageSize = vmem::VirtualMemoryManager::kPageSize;
+
+    size_t probe = kPageSize - (phys & (kPageSize - 1));
+    if (probe < sizeof(SdtHeader))
+        probe += kPageSize;
+
+    const SdtHeader* header =
+        static_cast<const SdtHeader*>(MapPhys(phys, probe));
+    if (!header)
+        return nullptr;
+
+    uint32_t length = header->length;
+    if (memcmp(header->signature, signature, 4) ||
+        (length < sizeof(SdtHeader)) || (length > kMaxTableLength)) {
+        UnmapPhys(header, probe);
+        return nullptr;
+    }
+
+    if (length > probe) {
+        UnmapPhys(header, probe);
+        header = static_cast<const SdtHeader*>(MapPhys(phys, length));
+        if (!header)
+            return nullptr;
+    }
+
+    /* The probe covers the same pages as the table when it fits, so the
+       table's own length is enough to unmap it later on. */
+    if (!ChecksumOk(header, length)) {
+        UnmapPhys(header, length);
+        return nullptr;
+    }
+    return header;
+}
+
+/*!
+ * \brief Return the RSDP in [\a start, \a end) or nullptr.
+ */
+static const Rsdp* ScanRsdp(uint32_t start, uint32_t end)
+{
+    /* The RSDP sits on a 16 byte boundary. */
+    for (uint32_t phys = start; (phys + sizeof(Rsdp)) <= end; phys += 16) {
+        const Rsdp* rsdp = static_cast<const Rsdp*>(vmem::PhysToVirt(phys));
+        if (!memcmp(rsdp->signature, "RSD PTR ", 8) &&
+            ChecksumOk(rsdp, sizeof(Rsdp)))
+            return rsdp;
+    }
+    return nullptr;
+}
+
+/*!
+ * \brief Return the RSDP or nullptr.
+ */
+static const Rsdp* FindRsdp()
+{
+    uint32_t ebda = static_cast<uint32_t>(
+        *static_cast<const uint16_t*>(vmem::PhysToVirt(kEbdaSegmentPtr))) << 4;
+    if (ebda && (ebda < kBiosAreaStart)) {
+        const Rsdp* rsdp = ScanRsdp(ebda, ebda + 1024);
+        if (rsdp)
+            return rsdp;
+    }
+    return ScanRsdp(kBiosAreaStart, kBiosAreaEnd);
+}
+
+/*!
+ * \brief Return the MADT listed in the RSDT or nullptr.
+ *
+ * On success the RSDT stays mapped too and is returned in \a rsdt_out.
+ */
+static const MadtHeader* FindMadt(const SdtHeader** rsdt_out)
+{
+    const Rsdp* rsdp = FindRsdp();
+    if (!rsdp)
+        return nullptr;
+
+    const SdtHeader* rsdt = MapTable(rsdp->rsdt_phys, "RSDT");
+    if (!rsdt)
+        return nullptr;
+
+    size_t          count   = (rsdt->length - sizeof(SdtHeader)) / sizeof(uint32_t);
+    const uint32_t* entries = reinterpret_cast<const uint32_t*>(rsdt + 1);
+    for (size_t i = 0; i < count; ++i) {
+        const SdtHeader* table = MapTable(entries[i], "APIC");
+        if (!table)
+            continue;
+        if (table->length >= sizeof(MadtHeader)) {
+            *rsdt_out = rsdt;
+            return reinterpret_cast<const MadtHeader*>(table);
+        }
+        UnmapTable(table);
+    }
+    UnmapTable(rsdt);
+    return nullptr;
+}
+
+bool ParseMadt(MadtInfo* info)
+{
+    const SdtHeader*  rsdt = nullptr;
+    const MadtHeader* madt = FindMadt(&rsdt);
+    if (!madt)
+        return false;
+
+    memset(info, 0, sizeof(*info));
+    info->lapic_phys  = madt->lapic_phys;
+    info->pcat_compat = (0 != (madt->flags & kMadtPcatCompat));
+    for (size_t irq = 0; irq < kNumIsaIrqs; ++irq)
+        info->isa_gsi[irq] = irq;
+
+    const uint8_t* entry = reinterpret_cast<const uint8_t*>(madt + 1);
+    const uint8_t* end   = reinterpret_cast<const uint8_t*>(madt) +
+                           madt->header.length;
+    while ((entry + 2) <= end) {
+        uint8_t length = entry[1];
+        if ((length < 2) || ((entry + length) > end))
+            break;
+
+        if ((kMadtIoApic == entry[0]) && (length >= sizeof(MadtIoApic)) &&
+            (info->num_io_apics < kMaxIoApics)) {
+            const MadtIoApic* io_apic = reinterpret_cast<const MadtIoApic*>(entry);
+            IoApicInfo&       out     = info->io_apics[info->num_io_apics++];
+            out.id       = io_apic->id;
+            out.phys     = io_apic->phys;
+            out.gsi_base = io_apic->gsi_base;
+        } else if ((kMadtOverride == entry[0]) &&
+                   (length >= sizeof(MadtOverride))) {
+            const MadtOverride* over = reinterpret_cast<const MadtOverride*>(entry);
+            if (!over->bus && (over->source < kNumIsaIrqs)) {
+                info->isa_gsi[over->source]   = over->gsi;
+                info->isa_flags[over->source] = over->flags;
+            }
+        }
+        entry += length;
+    }
+
+    /* Everything needed was copied to info, unmap the tables in the
+       reverse order of mapping so the I/O window space is handed back. */
+    UnmapTable(&madt->header);
+    UnmapTable(rsdt);
+    return info->num_io_apics > 0;
+}
+} // end acpi
+} // end cosmo
@@ -0,0 +1,214 @@
+#include <stdint.h>
+#include <stddef.h>
+
+#include "Apic.h"
+#include "Cpu.h"
+#include "VirtualMemoryManager.h"
+
+namespace cosmo
+{
+/* Local APIC registers, byte offsets. */
+static const uint32_t kLapicSize  = 0x400;
+static const uint32_t kLapicId    = 0x020;
+static const uint32_t kLapicTpr   = 0x080;
+static const uint32_t kLapicEoi   = 0x0B0;
+static const uint32_t kLapicSvr   = 0x0F0;
+static const uint32_t kLapicLint0 = 0x350;
+static const uint32_t kLapicLint1 = 0x360;
+
+static const uint32_t kSvrEnable      = 1 << 8;  /*!< SVR: APIC software enable. */
+static const uint32_t kLvtMasked      = 1 << 16; /*!< LVT: entry masked. */
+static const uint32_t kLvtNmi         = 4 << 8;  /*!< LVT: NMI delivery mode. */
+static const uint64_t kApicBaseEnable = 1 << 11; /*!< IA32_APIC_BASE: global enable. */
+
+/* IO-APIC registers. IOREGSEL selects the register IOWIN reads and
+   writes. */
+static const uint32_t kIoApicSize = 0x20;
+static const uint32_t kIoRegSel   = 0x00 / 4;
+static const uint32_t kIoWin      = 0x10 / 4;
+static const uint32_t kIoApicVer  = 0x01;
+static const uint32_t kIoRedTbl   = 0x10;
+
+static const uint32_t kRedirActiveLow = 1 << 13; /*!< Redirection: active low. */
+static const uint32_t kRedirLevel     = 1 << 15; /*!< Redirection: level triggered. */
+static const uint32_t kRedirMasked    = 1 << 16; /*!< Redirection: masked. */
+
+/*!
+ * \struct IoApic
+ * \brief A mapped IO-APIC.
+ */
+struct IoApic
+{
+    volatile uint32_t* regs;     /*!< Register window. */
+    uint32_t           gsi_base; /*!< GSI of pin 0. */
+    uint32_t           pins;     /*!< Number of redirection entries. */
+}; // end IoApic
+
+/*!
+ * \struct IrqRoute
+ * \brief The IO-APIC pin an IRQ line is wired to.
+ */
+struct IrqRoute
+{
+    IoApic*  io_apic;   /*!< IO-APIC of the pin, nullptr if not routable. */
+    uint32_t pin;       /*!< Pin number. */
+    uint32_t redir_low; /*!< Shadow of the low redirection entry word. */
+}; // end IrqRoute
+
+static volatile uint32_t* lapic_regs = nullptr;
+static IoApic             io_apics[acpi::kMaxIoApics];
+static size_t             num_io_apics = 0;
+static IrqRoute           routes[apic::kNumLines];
+
+static uint32_t IoApicRead(const IoApic& io_apic, uint32_t reg)
+{
+    io_apic.regs[kIoRegSel] = reg;
+    return io_apic.regs[kIoWin];
+}
+
+static void IoApicWrite(const IoApic& io_apic, uint32_t reg, uint32_t value)
+{
+    io_apic.regs[kIoRegSel] = reg;
+    io_apic.regs[kIoWin]    = value;
+}
+
+static IoApic* FindIoApic(uint32_t gsi)
+{
+    for (size_t i = 0; i < num_io_apics; ++i) {
+        if ((gsi >= io_apics[i].gsi_base) &&
+            ((gsi - io_apics[i].gsi_base) < io_apics[i].pins))
+            return &io_apics[i];
+    }
+    return nullptr;
+}
+
+/*!
+ * \brief Return \c true if an override hands \a gsi to an ISA IRQ other than
+ *        \a irq_line.
+ *
+ * The PIT's IRQ 0 for example is usually wired to GSI 2, which then does not
+ * belong to IRQ line 2.
+ */
+static bool IsOverridden(const acpi::MadtInfo& madt, uint8_t irq_line,
+                         uint32_t gsi)
+{
+    for (uint32_t irq = 0; irq < acpi::kNumIsaIrqs; ++irq) {
+        if ((irq != irq_line) && (gsi == madt.isa_gsi[irq]) &&
+            (irq != madt.isa_gsi[irq]))
+            return true;
+    }
+    return false;
+}
+
+bool apic::IsSupported()
+{
+    return 0 != (cpu::Cpuid(cpu::kCpuidFeatureLeaf).edx & cpu::kCpuidEdxApic);
+}
+
+bool apic::Init(const acpi::MadtInfo& madt)
+{
+    auto& vmm = vmem::VirtualMemoryManager::GetInstance();
+
+    /* Map every register window before touching the hardware, on failure
+       the caller keeps using the PICs as the firmware left them. */
+    void* lapic = vmm.MapIo(madt.lapic_phys, kLapicSize);
+    if (!lapic)
+        return false;
+
+    void* regs[acpi::kMaxIoApics];
+    for (size_t i = 0; i < madt.num_io_apics; ++i) {
+        regs[i] = vmm.MapIo(madt.io_apics[i].phys, kIoApicSize);
+        if (!regs[i]) {
+            /* Unmap in reverse order to hand the I/O window back. */
+            while (i--)
+                vmm.UnmapIo(regs[i], kIoApicSize);
+            vmm.UnmapIo(lapic, kLapicSize);
+            return false;
+        }
+    }
+
+    cpu::WriteMsr(cpu::kMsrApicBase,
+                  cpu::ReadMsr(cpu::kMsrApicBase) | kApicBaseEnable);
+    lapic_regs = static_cast<volatile uint32_t*>(lapic);
+
+    /* Mask every pin first, whatever the firmware left in the redirection
+       table must not fire before its line is set up. */
+    num_io_apics = 0;
+    for (size_t i = 0; i < madt.num_io_apics; ++i) {
+        IoApic& io_apic  = io_apics[num_io_apics++];
+        io_apic.regs     = static_cast<volatile uint32_t*>(regs[i]);
+        io_apic.gsi_base = madt.io_apics[i].gsi_base;
+        io_apic.pins     = ((IoApicRead(io_apic, kIoApicVer) >> 16) & 0xFF) + 1;
+        for (uint32_t pin = 0; pin < io_apic.pins; ++pin)
+            IoApicWrite(io_apic, kIoRedTbl + (2 * pin), kRedirMasked);
+    }
+
+    /* Deliver everything to the boot CPU in physical destination mode. */
+    uint32_t dest = lapic_regs[kLapicId / 4] >> 24;
+    for (uint8_t line = 0; line < kNumLines; ++line) {
+        IrqRoute& route = routes[line];
+        route.io_apic   = nullptr;
+
+        /* ISA IRQs default to active high and edge triggered, the PCI pins
+           behind GSIs 16 and up to active low and level triggered. */
+        uint32_t gsi   = line;
+        uint16_t flags = acpi::kIntiActiveLow | acpi::kIntiLevel;
+        if (line < acpi::kNumIsaIrqs) {
+            gsi   = madt.isa_gsi[line];
+            flags = madt.isa_flags[line];
+        }
+
+        IoApic* io_apic = FindIoApic(gsi);
+        if (!io_apic || IsOverridden(madt, line, gsi))
+            continue;
+
+        uint32_t redir = (kIrqVectorBase + line) | kRedirMasked;
+        if (acpi::kIntiActiveLow == (flags & acpi::kIntiPolarityMask))
+            redir |= kRedirActiveLow;
+        if (acpi::kIntiLevel == (flags & acpi::kIntiTriggerMask))
+            redir |= kRedirLevel;
+
+        route.io_apic   = io_apic;
+        route.pin       = gsi - io_apic->gsi_base;
+        route.redir_low = redir;
+        IoApicWrite(*io_apic, kIoRedTbl + (2 * route.pin) + 1, dest << 24);
+        IoApicWrite(*io_apic, kIoRedTbl + (2 * route.pin), redir);
+    }
+
+    lapic_regs[kLapicTpr / 4]   = 0;
+    lapic_regs[kLapicLint0 / 4] = kLvtMasked;
+    lapic_regs[kLapicLint1 / 4] = kLvtNmi;
+    lapic_regs[kLapicSvr / 4]   = kSvrEnable | kSpuriousVector;
+    return true;
+}
+
+bool apic::IsRoutable(uint8_t irq_line)
+{
+    return (irq_line < kNumLines) && routes[irq_line].io_apic;
+}
+
+void apic::SendEOI()
+{
+    lapic_regs[kLapicEoi / 4] = 0;
+}
+
+void apic::SetMask(uint8_t irq_line)
+{
+    if (!IsRoutable(irq_line))
+        return;
+
+    IrqRoute& route = routes[irq_line];
+    route.redir_low |= kRedirMasked;
+    IoApicWrite(*route.io_apic, kIoRedTbl + (2 * route.pin), route.redir_low);
+}
+
+void apic::ClearMask(uint8_t irq_line)
+{
+    if (!IsRoutable(irq_line))
+        return;
+
+    IrqRoute& route = routes[irq_line];
+    route.redir_low &= ~kRedirMasked;
+    IoApicWrite(*route.io_apic, kIoRedTbl + (2 * route.pin), route.redir_low);
+}
+} // end cosmo
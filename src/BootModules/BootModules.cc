@@ -0,0 +1,96 @@
+#include <stdint.h>
+#include <stddef.h>
+
+#include "multiboot.h"
+#include "PhysMap.h"
+#include "VirtualMemoryManager.h"
+#include "BootModules.h"
+
+namespace cosmo
+{
+namespace boot
+{
+static const uint32_t kPageSize = vmem::VirtualMemoryManager::kPageSize;
+
+BootModules& BootModules::GetInstance()
+{
+    static BootModules modules;
+    return modules;
+}
+
+void BootModules::Init(const multiboot_info_t* mb_info)
+{
+    count_ = 0;
+    if (!(mb_info->flags & MULTIBOOT_INFO_MODS))
+        return;
+
+    const multiboot_module_t* mods =
+        static_cast<const multiboot_module_t*>(
+            vmem::PhysToVirt(mb_info->mods_addr));
+    for (uint32_t i = 0; (i < mb_info->mods_count) && (count_ < kMaxModules);
+         ++i) {
+        if (mods[i].mod_end < mods[i].mod_start)
+            continue;
+
+        BootModule& module = modules_[count_++];
+        module.phys_start  = mods[i].mod_start;
+        module.phys_end    = mods[i].mod_end;
+        module.cmdline     = mods[i].cmdline ?
+            static_cast<const char*>(vmem::PhysToVirt(mods[i].cmdline)) : "";
+        module.data        = nullptr;
+    }
+}
+
+const BootModule* BootModules::GetModule(size_t index) const
+{
+    return (index < count_) ? &modules_[index] : nullptr;
+}
+
+int BootModules::FindModule(const char* name) const
+{
+    for (size_t i = 0; i < count_; ++i) {
+        const char* cmdline = modules_[i].cmdline;
+        const char* n       = name;
+        while (*n && (*n == *cmdline)) {
+            n++;
+            cmdline++;
+        }
+        if (!*n && (!*cmdline || (' ' == *cmdline)))
+            return static_cast<int>(i);
+    }
+    return -1;
+}
+
+const void* BootModules::Map(size_t index)
+{
+    if (index >= count_)
+        return nullptr;
+
+    BootModule& module = modules_[index];
+    if (module.data)
+        return module.data;
+
+    /* MODULEALIGN in loader.nasm makes GRUB page align the modules, but do
+       not rely on it. */
+    uint32_t first = module.phys_start & ~(kPageSize - 1);
+    uint32_t pages = (module.phys_end - first + kPageSize - 1) / kPageSize;
+    if (!pages)
+        pages = 1;
+
+    /* One extra page stays unmapped as a guard. */
+    uint32_t span = (pages + 1) * kPageSize;
+    if (span > (kWindowBase + kWindowSize - window_next_))
+        return nullptr;
+
+    /* No kPageWritable: the mapping is read-only (CR0.WP is set). */
+    if (!vmem::VirtualMemoryManager::GetInstance().MapRange(window_next_, first,
+                                                            pages, 0))
+        return nullptr;
+
+    module.data   = reinterpret_cast<const void*>(
+                        window_next_ + (module.phys_start - first));
+    window_next_ += span;
+    return module.data;
+}
+} // end boot
+} // end cosmo
@@ -1,10 +1,12 @@
 #include <stdint.h>
 
+#include "Cpu.h"
 #include "IRQ/Keyboard/KeyboardIrq.h"
 #include "InterruptHandler.h"
+#include "IrqDispatcher.h"
+#include "RingBuffer.h"
+#include "SoftIrq.h"
 #include "PortIO.h"
-#include "ProgrammableInterruptController.h"
-#include "FrameBuffer.h"
 
 namespace cosmo
 {
@@ -17,20 +19,40 @@ uint8_t kbd::ReadScanCode()
     static const int kKbdDataPort = 0x60;
 
     /* Read in the KBD scan code. */
-    uint8_t scan_code = inb(kKbdDataPort);
+    return inb(kKbdDataPort);
+}
+
+/* Scan code set 1 codes the decoder needs to know about. */
+static const uint8_t kExtendedPrefix = 0xE0;
+static const uint8_t kBreakBit       = 0x80;
+static const uint8_t kLeftShift      = 0x2A;
+static const uint8_t kRightShift     = 0x36;
+static const uint8_t kCtrl           = 0x1D;
+static const uint8_t kAlt            = 0x38;
+static const uint8_t kCapsLock       = 0x3A;
+
+/* Set 1 scan codes below kNumKeys map to characters. */
+static const int kNumKeys = 0x3A;
 
-    /* Let the master PIC know we have finished servicing the interrupt. */
-    cosmo::pic::SendEOI(cosmo::interrupt::Irq::kKeyboard);
+static RingBuffer<uint8_t, kbd::kScanCodeSlots>& ScanCodes()
+{
+    static RingBuffer<uint8_t, kbd::kScanCodeSlots> scan_codes;
+    return scan_codes;
+}
 
-    return scan_code;
+static RingBuffer<kbd::KeyEvent, kbd::kEventSlots>& Events()
+{
+    static RingBuffer<kbd::KeyEvent, kbd::kEventSlots> events;
+    return events;
 }
 
-void kbd::PrintAsciiChar(uint8_t scan_code)
+/*!
+ * \brief Return the US layout character of \a scan_code under \a modifiers.
+ */
+static char ToAscii(uint8_t scan_code, uint8_t modifiers)
 {
-    constexpr int kNumKeys = 128;
     if (scan_code >= kNumKeys)
-        /* Avoid trying to index the key map with an invalid scan code. */
-        return;
+        return 0;
 
     static const char kUsKeyboardLayout[kNumKeys] =
     {
@@ -44,33 +66,147 @@ void kbd::PrintAsciiChar(uint8_t scan_code)
         'z', 'x', 'c', 'v', 'b', 'n', 'm', ',', '.', '/',   0,
         '*',
         0,  /* Alt */
-        ' ',  /* Space */
-        0,  /* Caps Locks */
-        0,  /* 59 - F1 key ... */
-        0,   0,   0,   0,   0,   0,   0,   0,
-        0,  /* ... F10 */
-        0,  /* Numlock */
-        0,  /* Scroll Lock */
-        0,  /* Home Key */
-        0,  /* Up Arrow */
-        0,  /* Page Up */
-        '-',
-        0,  /* Left Arrow */
-        0,
-        0,  /* Right Arrow */
-        '+',
-        0,  /* End Key */
-        0,  /* Down Arrow */
-        0,  /* Page Down */
-        0,  /* Insert Key */
-        0,  /* Delete Key */
-        0,   0,   0,
-        0,  /* F11 Key */
-        0,  /* F12 Key */
-        0  /* All other keys are undefined. */
+        ' '  /* Space */
     };
 
-    cosmo::FrameBuffer::GetInstance().PrintChar(kUsKeyboardLayout[scan_code]);
+    static const char kUsKeyboardLayoutShift[kNumKeys] =
+    {
+        0,  27, '!', '@', '#', '$', '%', '^', '&', '*', '(', ')', '_', '+',
+        '\b',
+        '\t',
+        'Q', 'W', 'E', 'R', 'T', 'Y', 'U', 'I', 'O', 'P', '{', '}',
+        '\n',
+        0, /* CTRL */
+        'A', 'S', 'D', 'F', 'G', 'H', 'J', 'K', 'L', ':', '"', '~',  0, '|',
+        'Z', 'X', 'C', 'V', 'B', 'N', 'M', '<', '>', '?',   0,
+        '*',
+        0,  /* Alt */
+        ' '  /* Space */
+    };
+
+    bool shift = (0 != (modifiers & kbd::kModShift));
+    char c     = kUsKeyboardLayout[scan_code];
+
+    /* Caps lock only inverts the shift state of letters. */
+    if ((c >= 'a') && (c <= 'z') && (modifiers & kbd::kModCapsLock))
+        shift = !shift;
+
+    return shift ? kUsKeyboardLayoutShift[scan_code] : c;
+}
+
+/*!
+ * \brief Keyboard bottom half, decodes the queued scan codes into events.
+ */
+static void DecodeScanCodes(uint32_t data)
+{
+    (void)data;
+
+    /* Decoder state, only touched by this function. */
+    static uint8_t modifiers = 0;
+    static bool    extended  = false;
+
+    uint8_t code = 0;
+    while (ScanCodes().Pop(&code)) {
+        if (kExtendedPrefix == code) {
+            extended = true;
+            continue;
+        }
+
+        kbd::KeyEvent event;
+        event.scan_code = code & ~kBreakBit;
+        event.pressed   = !(code & kBreakBit);
+        event.extended  = extended;
+        extended        = false;
+
+        uint8_t modifier = 0;
+        switch (event.scan_code) {
+            case kLeftShift:
+            case kRightShift:
+                /* The extended codes are fake shifts sent around print
+                   screen and the navigation keys. */
+                modifier = event.extended ? 0 : kbd::kModShift;
+                break;
+            case kCtrl:
+                modifier = kbd::kModCtrl;
+                break;
+            case kAlt:
+                modifier = kbd::kModAlt;
+                break;
+            case kCapsLock:
+                if (event.pressed)
+                    modifiers ^= kbd::kModCapsLock;
+                break;
+            default:
+                break;
+        }
+        if (modifier)
+            modifiers = event.pressed ? (modifiers | modifier)
+                                      : (modifiers & ~modifier);
+
+        event.modifiers = modifiers;
+        event.ascii     = event.extended ? 0 : ToAscii(event.scan_code, modifiers);
+        Events().Push(event);
+    }
+}
+
+bool kbd::HandleIrq(void* context)
+{
+    (void)context;
+
+    /* Reading the scan code is all the keyboard needs before the EOI. The
+       decoder drains the whole ring, so it only has to be raised when the
+       ring was empty. */
+    auto& scan_codes = ScanCodes();
+    bool  idle       = scan_codes.IsEmpty();
+    if (scan_codes.Push(ReadScanCode()) && idle)
+        SoftIrq::GetInstance().Raise(Irq::kKeyboard, DecodeScanCodes, 0);
+    return true;
+}
+
+bool kbd::Init()
+{
+    return IrqDispatcher::GetInstance().Register(Irq::kKeyboard, HandleIrq,
+                                                 nullptr);
+}
+
+bool kbd::PollEvent(KeyEvent* event)
+{
+    return Events().Pop(event);
+}
+
+bool kbd::HasEvents()
+{
+    return !Events().IsEmpty();
+}
+
+kbd::KeyEvent kbd::WaitEvent()
+{
+    auto&    softirq = SoftIrq::GetInstance();
+    KeyEvent event;
+    while (!PollEvent(&event)) {
+        /* The event may still sit in a pending bottom half. */
+        if (softirq.Run())
+            continue;
+
+        /* sti only takes effect after the following hlt has started, so an
+           interrupt that arrives after the check still wakes us up. */
+        cpu::DisableInterrupts();
+        if (!HasEvents() && !softirq.IsPending())
+            __asm__ volatile("sti\n\thlt" ::: "memory");
+        else
+            cpu::EnableInterrupts();
+    }
+    return event;
+}
+
+kbd::KbdStats kbd::GetStats()
+{
+    KbdStats stats;
+    stats.scan_codes_dropped   = ScanCodes().GetDropped();
+    stats.scan_code_high_water = ScanCodes().GetHighWater();
+    stats.events_dropped       = Events().GetDropped();
+    stats.event_high_water     = Events().GetHighWater();
+    return stats;
 }
 } // end irq
 } // end interrupt
@@ -1,6 +1,7 @@
 #include <stdint.h>
 #include <string.h>
 
+#include "Apic.h"
 #include "InterruptHandler.h"
 #include "InterruptDescriptorTable.h"
 
@@ -49,8 +50,8 @@ InterruptDescriptorTable::InterruptDescriptorTable()
     SetGate(30, reinterpret_cast<uintptr_t>(interrupt::isr30));
     SetGate(31, reinterpret_cast<uintptr_t>(interrupt::isr31));
 
-    /* Register 16 IRQ handlers. See InterruptHandler.[h,cc,nasm]
-       for details. */
+    /* Register 24 IRQ handlers. See InterruptHandler.[h,cc,nasm]
+       for details. Lines 16-23 are only raised by the IO-APIC. */
     SetGate(32, reinterpret_cast<uintptr_t>(interrupt::irq0));
     SetGate(33, reinterpret_cast<uintptr_t>(interrupt::irq1));
     SetGate(34, reinterpret_cast<uintptr_t>(interrupt::irq2));
@@ -67,10 +68,21 @@ InterruptDescriptorTable::InterruptDescriptorTable()
     SetGate(45, reinterpret_cast<uintptr_t>(interrupt::irq13));
     SetGate(46, reinterpret_cast<uintptr_t>(interrupt::irq14));
     SetGate(47, reinterpret_cast<uintptr_t>(interrupt::irq15));
+    SetGate(48, reinterpret_cast<uintptr_t>(interrupt::irq16));
+    SetGate(49, reinterpret_cast<uintptr_t>(interrupt::irq17));
+    SetGate(50, reinterpret_cast<uintptr_t>(interrupt::irq18));
+    SetGate(51, reinterpret_cast<uintptr_t>(interrupt::irq19));
+    SetGate(52, reinterpret_cast<uintptr_t>(interrupt::irq20));
+    SetGate(53, reinterpret_cast<uintptr_t>(interrupt::irq21));
+    SetGate(54, reinterpret_cast<uintptr_t>(interrupt::irq22));
+    SetGate(55, reinterpret_cast<uintptr_t>(interrupt::irq23));
 
     /* Mark remaining interrupt vectors as disabled/undefined. */
-    for (int i = 48; i < kMaxIdtEntries; ++i)
+    for (int i = 56; i < kMaxIdtEntries; ++i)
         enabled_vectors_[i] = false;
+
+    SetGate(apic::kSpuriousVector,
+            reinterpret_cast<uintptr_t>(interrupt::apic_spurious));
 }
 
 InterruptDescriptorTable& InterruptDescriptorTable::GetInstance()
@@ -1,30 +1,38 @@
 #include "InterruptHandler.h"
-#include "ProgrammableInterruptController.h"
-#include "IRQ/Keyboard/KeyboardIrq.h"
+#include "IrqDispatcher.h"
 #include "Logger.h"
+#include "SoftIrq.h"
+#include "VirtualMemoryManager.h"
 
 namespace cosmo
 {
 void interrupt::isr_handler(struct InterruptContext* int_context)
 {
-    LOG_ERROR("error, unhandled exception %X\n",
-              static_cast<unsigned int>(int_context->int_no));
+    if (Exception::kPageFault == int_context->int_no) {
+        /* Demand paging fast path. A resolved fault returns straight to the
+           faulting instruction without going through the logger. */
+        if (vmem::VirtualMemoryManager::GetInstance().HandlePageFault(
+                int_context->cr2, int_context->err_code))
+            return;
+
+        LOG_ERROR("error, page fault at %X (error code %X)\n",
+                  static_cast<unsigned int>(int_context->cr2),
+                  static_cast<unsigned int>(int_context->err_code));
+    } else {
+        LOG_ERROR("error, unhandled exception %X\n",
+                  static_cast<unsigned int>(int_context->int_no));
+    }
 
     /* Halt the machine on an unhandled CPU exception. */
     for (;;)
         __asm__ volatile("hlt");
 }
 
-void interrupt::irq_handler(struct InterruptContext* int_context)
+void interrupt::irq_handler(uint32_t irq)
 {
-    switch(int_context->int_no) {
-        case Irq::kKeyboard:
-            /* Print the ASCII character that corresponds to the keypress. */
-            irq::kbd::PrintAsciiChar(irq::kbd::ReadScanCode());
-            break;
-        default:
-            LOG_ERROR("error, unhandled IRQ %X\n",
-                      static_cast<unsigned int>(int_context->int_no));
-    }
+    IrqDispatcher::GetInstance().Dispatch(static_cast<uint8_t>(irq));
+
+    /* The IRQ is acknowledged, run the bottom halves before returning. */
+    SoftIrq::GetInstance().Run();
 }
 } // end cosmo
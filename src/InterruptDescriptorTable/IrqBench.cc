@@ -0,0 +1,59 @@
+#ifdef COSMO_IRQ_BENCH
+#include <stdint.h>
+
+#include "Cpu.h"
+#include "InterruptDescriptorTable.h"
+#include "InterruptHandler.h"
+#include "Logger.h"
+
+namespace cosmo
+{
+namespace interrupt
+{
+static const uint8_t kBenchFullVector = 0xF0;  /*!< Vector of irq_bench_full(). */
+static const uint8_t kBenchLeanVector = 0xF1;  /*!< Vector of irq_bench_lean(). */
+static const int     kBenchWarmup     = 100;   /*!< Untimed rounds per path. */
+static const int     kBenchRounds     = 10000; /*!< Timed rounds per path. */
+
+extern "C" void irq_bench_handler(uint32_t arg)
+{
+    (void)arg;
+}
+
+/*!
+ * \brief Return the average cycles of a software interrupt to \a kVector.
+ */
+template <uint8_t kVector>
+static uint32_t MeasureEntry()
+{
+    /* Warm up the caches and branch predictors first. */
+    for (int i = 0; i < kBenchWarmup; ++i)
+        __asm__ volatile("int %0" : : "i"(kVector) : "memory");
+
+    uint64_t start = cpu::ReadTsc();
+    for (int i = 0; i < kBenchRounds; ++i)
+        __asm__ volatile("int %0" : : "i"(kVector) : "memory");
+    return static_cast<uint32_t>((cpu::ReadTsc() - start) / kBenchRounds);
+}
+
+void RunIrqBench()
+{
+    auto& idt = InterruptDescriptorTable::GetInstance();
+    idt.SetGate(kBenchFullVector, reinterpret_cast<uintptr_t>(irq_bench_full));
+    idt.SetGate(kBenchLeanVector, reinterpret_cast<uintptr_t>(irq_bench_lean));
+
+    uint32_t full = 0;
+    uint32_t lean = 0;
+    {
+        /* Keep real IRQs out of the timed loops. */
+        cpu::InterruptGuard guard;
+        full = MeasureEntry<kBenchFullVector>();
+        lean = MeasureEntry<kBenchLeanVector>();
+    }
+
+    LOG_INFO("IRQ entry: full path %d cycles, lean path %d cycles\n",
+             static_cast<int>(full), static_cast<int>(lean));
+}
+} // end interrupt
+} // end cosmo
+#endif
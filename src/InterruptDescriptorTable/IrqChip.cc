@@ -0,0 +1,107 @@
+#include <stdint.h>
+
+#include "Acpi.h"
+#include "Apic.h"
+#include "Cpu.h"
+#include "InterruptHandler.h"
+#include "IrqChip.h"
+#include "ProgrammableInterruptController.h"
+
+namespace cosmo
+{
+namespace interrupt
+{
+static_assert(IrqChip::kMaxLines == apic::kNumLines,
+              "the APIC routes every IRQ line");
+static_assert(IrqChip::kMaxLines <= 32, "unmasked_ has a bit per line");
+
+uint32_t apic_spurious_count = 0;
+
+IrqChip& IrqChip::GetInstance()
+{
+    static IrqChip chip;
+    return chip;
+}
+
+bool IrqChip::UseApic()
+{
+    if (Type::kApic == type_)
+        return true;
+
+    acpi::MadtInfo madt;
+    if (!apic::IsSupported() || !acpi::ParseMadt(&madt))
+        return false;
+
+    cpu::InterruptGuard guard;
+
+    if (!apic::Init(madt))
+        return false;
+
+    pic::Disable();
+    type_ = Type::kApic;
+
+    for (uint8_t irq = 0; irq < kMaxLines; ++irq) {
+        if (unmasked_ & (1u << irq))
+            apic::ClearMask(irq);
+    }
+    return true;
+}
+
+void IrqChip::Mask(uint8_t irq)
+{
+    if (irq >= kMaxLines)
+        return;
+
+    unmasked_ &= ~(1u << irq);
+    if (Type::kApic == type_)
+        apic::SetMask(irq);
+    else if (irq < 16)
+        pic::SetMask(irq);
+}
+
+void IrqChip::Unmask(uint8_t irq)
+{
+    if (irq >= kMaxLines)
+        return;
+
+    unmasked_ |= 1u << irq;
+    if (Type::kApic == type_) {
+        apic::ClearMask(irq);
+    } else if (irq < 16) {
+        /* Slave lines also need the cascade. */
+        if (irq >= 8)
+            pic::ClearMask(Irq::kPic2);
+        pic::ClearMask(irq);
+    }
+}
+
+void IrqChip::SendEOI(uint8_t irq)
+{
+    if (Type::kApic == type_)
+        apic::SendEOI();
+    else
+        pic::SendEOI(irq);
+}
+
+bool IrqChip::IsSpurious(uint8_t irq)
+{
+    /* Each PIC reports a spurious interrupt on its lowest priority line,
+       IRQ 7 or 15, without setting the line's in-service bit. */
+    if ((Type::kApic == type_) || (7 != (irq & 7)) || (irq >= 16))
+        return false;
+
+    if (pic::GetIsr() & (1 << irq))
+        return false;
+
+    /* A spurious IRQ 15 still went through the master's cascade line. */
+    if (irq >= 8)
+        pic::SendEOI(Irq::kPic2);
+    return true;
+}
+
+uint32_t IrqChip::GetApicSpurious() const
+{
+    return apic_spurious_count;
+}
+} // end interrupt
+} // end cosmo
@@ -0,0 +1,105 @@
+#include <stdint.h>
+#include <stddef.h>
+
+#include "Cpu.h"
+#include "IrqChip.h"
+#include "IrqDispatcher.h"
+
+namespace cosmo
+{
+namespace interrupt
+{
+IrqDispatcher& IrqDispatcher::GetInstance()
+{
+    static IrqDispatcher dispatcher;
+    return dispatcher;
+}
+
+IrqDispatcher::IrqDispatcher() :
+    counters_(), lines_(), slots_(), free_(nullptr), spurious_(0)
+{
+    for (size_t i = 0; i < kMaxHandlers; ++i) {
+        slots_[i].next = free_;
+        free_          = &slots_[i];
+    }
+}
+
+bool IrqDispatcher::Register(uint8_t irq, IrqHandlerFn handler, void* context)
+{
+    if ((irq >= kNumIrqs) || !handler)
+        return false;
+
+    cpu::InterruptGuard guard;
+
+    HandlerSlot* slot = free_;
+    if (!slot)
+        return false;
+    free_ = slot->next;
+
+    /* Append, so handlers run in registration order. */
+    slot->handler = handler;
+    slot->context = context;
+    slot->next    = nullptr;
+
+    HandlerSlot** link = &lines_[irq];
+    while (*link)
+        link = &(*link)->next;
+    *link = slot;
+
+    if (lines_[irq] == slot)
+        IrqChip::GetInstance().Unmask(irq);
+    return true;
+}
+
+bool IrqDispatcher::Unregister(uint8_t irq, IrqHandlerFn handler, void* context)
+{
+    if (irq >= kNumIrqs)
+        return false;
+
+    cpu::InterruptGuard guard;
+
+    for (HandlerSlot** link = &lines_[irq]; *link; link = &(*link)->next) {
+        HandlerSlot* slot = *link;
+        if ((slot->handler != handler) || (slot->context != context))
+            continue;
+
+        *link      = slot->next;
+        slot->next = free_;
+        free_      = slot;
+
+        if (!lines_[irq])
+            IrqChip::GetInstance().Mask(irq);
+        return true;
+    }
+    return false;
+}
+
+void IrqDispatcher::Dispatch(uint8_t irq)
+{
+    if (irq >= kNumIrqs)
+        return;
+
+    IrqChip& chip = IrqChip::GetInstance();
+    if (chip.IsSpurious(irq)) {
+        spurious_++;
+        return;
+    }
+
+    IrqCounters& counters = counters_[irq];
+    counters.hits++;
+
+    /* A handler may unregister itself, which pushes its slot on the free
+       list, so the next slot is read before the handler runs. */
+    bool         handled = false;
+    HandlerSlot* next    = nullptr;
+    for (HandlerSlot* slot = lines_[irq]; slot; slot = next) {
+        next    = slot->next;
+        handled = slot->handler(slot->context) || handled;
+    }
+    if (!handled)
+        counters.unhandled++;
+
+    chip.SendEOI(irq);
+}
+} // end interrupt
+} // end cosmo
@@ -0,0 +1,80 @@
+#include <stdint.h>
+#include <stddef.h>
+
+#include "Cpu.h"
+#include "SoftIrq.h"
+
+namespace cosmo
+{
+namespace interrupt
+{
+SoftIrq& SoftIrq::GetInstance()
+{
+    static SoftIrq softirq;
+    return softirq;
+}
+
+bool SoftIrq::Raise(uint8_t irq, SoftIrqFn fn, uint32_t data)
+{
+    if ((irq >= IrqDispatcher::kNumIrqs) || !fn)
+        return false;
+
+    if (!queues_[irq].Push({fn, data}))
+        return false;
+
+    /* The item is published, mark the line pending. */
+    __atomic_fetch_or(&pending_, 1u << irq, __ATOMIC_RELEASE);
+    return true;
+}
+
+void SoftIrq::Drain(uint8_t irq)
+{
+    /* Items raised from here on set the pending bit again. Stopping after
+       one ring's worth leaves them to the next round, which bounds a round
+       even if the line keeps firing. */
+    WorkItem item;
+    for (uint32_t i = 0; (i < kQueueSize) && queues_[irq].Pop(&item); ++i)
+        item.fn(item.data);
+
+    if (!queues_[irq].IsEmpty())
+        __atomic_fetch_or(&pending_, 1u << irq, __ATOMIC_RELAXED);
+}
+
+bool SoftIrq::Run()
+{
+    if (running_)
+        return false;
+    running_ = true;
+
+    uint32_t eflags = cpu::ReadEflags();
+    cpu::EnableInterrupts();
+
+    bool ran = false;
+    for (int round = 0; round < kMaxRounds; ++round) {
+        uint32_t pending = __atomic_exchange_n(&pending_, 0, __ATOMIC_ACQUIRE);
+        if (!pending)
+            break;
+
+        ran = true;
+        while (pending) {
+            Drain(static_cast<uint8_t>(__builtin_ctz(pending)));
+            pending &= pending - 1;
+        }
+    }
+
+    if (!(eflags & cpu::kEflagsIf))
+        cpu::DisableInterrupts();
+
+    running_ = false;
+    return ran;
+}
+
+uint32_t SoftIrq::GetDropped() const
+{
+    uint32_t dropped = 0;
+    for (const Queue& queue : queues_)
+        dropped += queue.GetDropped();
+    return dropped;
+}
+} // end interrupt
+} // end cosmo
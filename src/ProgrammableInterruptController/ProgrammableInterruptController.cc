@@ -61,6 +61,12 @@ void pic::Init(int offset1, int offset2)
     outb(PicPort::kPic2Data, a2);
 }
 
+void pic::Disable()
+{
+    outb(PicPort::kPic1Data, 0xFF);
+    outb(PicPort::kPic2Data, 0xFF);
+}
+
 void pic::SetMask(uint8_t irq_line)
 {
     uint16_t port = 0;
@@ -0,0 +1,150 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "Ramdisk.h"
+
+namespace cosmo
+{
+/* Offsets and sizes of the ustar header fields used by the reader. */
+static const size_t kNameOffset     = 0;
+static const size_t kNameSize       = 100;
+static const size_t kSizeOffset     = 124;
+static const size_t kSizeSize       = 12;
+static const size_t kChecksumOffset = 148;
+static const size_t kChecksumSize   = 8;
+static const size_t kTypeOffset     = 156;
+static const size_t kMagicOffset    = 257;
+static const size_t kPrefixOffset   = 345;
+static const size_t kPrefixSize     = 155;
+
+static const char kTypeRegular    = '0';
+static const char kTypeRegularOld = '\0';
+
+/*!
+ * \brief Parse the NUL or space terminated octal number in \a field.
+ */
+static size_t ParseOctal(const uint8_t* field, size_t len)
+{
+    size_t value = 0;
+    for (size_t i = 0; i < len; ++i) {
+        if ((field[i] < '0') || (field[i] > '7'))
+            break;
+        value = (value * 8) + (field[i] - '0');
+    }
+    return value;
+}
+
+/*!
+ * \brief Return \a path without leading "./" and "/".
+ */
+static const char* SkipRoot(const char* path)
+{
+    for (;;) {
+        if ('/' == path[0])
+            path++;
+        else if (('.' == path[0]) && ('/' == path[1]))
+            path += 2;
+        else
+            return path;
+    }
+}
+
+/*!
+ * \brief Copy at most \a len bytes of the possibly unterminated \a field
+ *        to \a dst and return the new end of \a dst.
+ */
+static char* CopyField(char* dst, const char* dst_end, const uint8_t* field,
+                       size_t len)
+{
+    for (size_t i = 0; (i < len) && field[i] && (dst < dst_end); ++i)
+        *dst++ = static_cast<char>(field[i]);
+    return dst;
+}
+
+bool Ramdisk::Init(const void* image, size_t size)
+{
+    image_ = static_cast<const uint8_t*>(image);
+    size_  = size;
+
+    /* An all zero first block is an empty archive. */
+    if ((size_ >= kBlockSize) && !Header(0)) {
+        for (size_t i = 0; i < kBlockSize; ++i) {
+            if (image_[i])
+                return false;
+        }
+    }
+    return true;
+}
+
+const uint8_t* Ramdisk::Header(size_t offset) const
+{
+    if ((offset > size_) || ((size_ - offset) < kBlockSize))
+        return nullptr;
+
+    const uint8_t* header = image_ + offset;
+    if (memcmp(header + kMagicOffset, "ustar", 5))
+        return nullptr;
+
+    /* The checksum is the byte sum of the header with the checksum field
+       taken as spaces. */
+    size_t sum = 0;
+    for (size_t i = 0; i < kBlockSize; ++i) {
+        bool in_field = (i >= kChecksumOffset) &&
+                        (i < (kChecksumOffset + kChecksumSize));
+        sum += in_field ? ' ' : header[i];
+    }
+    if (sum != ParseOctal(header + kChecksumOffset, kChecksumSize))
+        return nullptr;
+
+    return header;
+}
+
+bool Ramdisk::Next(size_t* cursor, RamdiskFile* file) const
+{
+    const uint8_t* header = nullptr;
+    while ((header = Header(*cursor))) {
+        size_t size   = ParseOctal(header + kSizeOffset, kSizeSize);
+        size_t data   = *cursor + kBlockSize;
+        size_t blocks = (size + kBlockSize - 1) / kBlockSize;
+        if ((size > size_) || (data + size > size_))
+            return false;
+        *cursor = data + (blocks * kBlockSize);
+
+        char type = static_cast<char>(header[kTypeOffset]);
+        if ((kTypeRegular != type) && (kTypeRegularOld != type))
+            continue;
+
+        /* path = prefix "/" name */
+        char        full[RamdiskFile::kMaxPath];
+        const char* full_end = full + sizeof(full) - 1;
+        char*       end      = CopyField(full, full_end, header + kPrefixOffset,
+                                         kPrefixSize);
+        if ((end != full) && (end < full_end))
+            *end++ = '/';
+        end  = CopyField(end, full_end, header + kNameOffset, kNameSize);
+        *end = '\0';
+
+        const char* path = SkipRoot(full);
+        size_t      len  = strlen(path);
+        memmove(file->path, path, len + 1);
+        file->data = image_ + data;
+        file->size = size;
+        return true;
+    }
+    return false;
+}
+
+bool Ramdisk::Open(const char* path, RamdiskFile* file) const
+{
+    path = SkipRoot(path);
+    size_t len = strlen(path);
+
+    size_t cursor = 0;
+    while (Next(&cursor, file)) {
+        if (!memcmp(file->path, path, len + 1))
+            return true;
+    }
+    return false;
+}
+} // end cosmo
@@ -0,0 +1,110 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "BuddyAllocator.h"
+
+namespace cosmo
+{
+namespace vmem
+{
+BuddyAllocator::BuddyAllocator()
+{
+    for (uint32_t k = 0; k <= kMaxOrder; ++k)
+        free_blocks_[k] = 0;
+}
+
+size_t BuddyAllocator::StorageWords(size_t nframes)
+{
+    size_t total = 0;
+    for (uint32_t k = 0; k <= kMaxOrder; ++k) {
+        size_t nblocks = nframes >> k;
+        total += SummaryBitmap::BitmapWords(nblocks) +
+                 SummaryBitmap::SummaryWords(nblocks);
+    }
+    return total;
+}
+
+void BuddyAllocator::Init(uint32_t* storage, size_t nframes)
+{
+    for (uint32_t k = 0; k <= kMaxOrder; ++k) {
+        /* Only whole blocks are tracked. A trailing partial block at this
+           order can never be free as a unit. */
+        size_t nblocks = nframes >> k;
+        size_t words   = SummaryBitmap::BitmapWords(nblocks);
+
+        /* All blocks start out unavailable. */
+        memset(storage, 0xFF, words * sizeof(uint32_t));
+        orders_[k].Init(storage, storage + words, nblocks);
+        orders_[k].Rebuild();
+
+        storage         += words + SummaryBitmap::SummaryWords(nblocks);
+        free_blocks_[k]  = 0;
+    }
+}
+
+int BuddyAllocator::AllocBlock(uint32_t order)
+{
+    if (order > kMaxOrder)
+        return -1;
+
+    for (uint32_t k = order; k <= kMaxOrder; ++k) {
+        int block = orders_[k].FirstUnset();
+        if (-1 == block)
+            continue;
+
+        orders_[k].Set(block);
+        free_blocks_[k]--;
+
+        /* Split the block down to the requested order. The upper half at
+           each step becomes a free block of the next lower order. */
+        uint32_t index = block;
+        while (k > order) {
+            k--;
+            index <<= 1;
+            orders_[k].Unset(index + 1);
+            free_blocks_[k]++;
+        }
+        return static_cast<int>(index << order);
+    }
+    return -1;
+}
+
+void BuddyAllocator::FreeBlock(uint32_t frame, uint32_t order)
+{
+    uint32_t index = frame >> order;
+    uint32_t k     = order;
+
+    /* Coalesce with the buddy block for as long as it is free. */
+    while (k < kMaxOrder) {
+        uint32_t buddy = index ^ 1;
+        if ((buddy >= orders_[k].Size()) || orders_[k].Test(buddy))
+            break;
+
+        orders_[k].Set(buddy);
+        free_blocks_[k]--;
+        index >>= 1;
+        k++;
+    }
+
+    orders_[k].Unset(index);
+    free_blocks_[k]++;
+}
+
+void BuddyAllocator::FreeRange(uint32_t frame, size_t count)
+{
+    while (count) {
+        /* The block must be naturally aligned and fit in the range. */
+        uint32_t order = kMaxOrder;
+        if (frame && (static_cast<uint32_t>(__builtin_ctz(frame)) < order))
+            order = __builtin_ctz(frame);
+        while ((static_cast<size_t>(1) << order) > count)
+            order--;
+
+        FreeBlock(frame, order);
+        frame += 1U << order;
+        count -= static_cast<size_t>(1) << order;
+    }
+}
+} // end vmem
+} // end cosmo
@@ -43,36 +43,155 @@ int BitmapFirstUnset(uint32_t *bitmap, size_t size) {
     return -1;
 }
 
+void BitmapSetRange(uint32_t* bitmap, uint32_t bit, size_t count)
+{
+    if (!count)
+        return;
+
+    uint32_t end   = bit + count - 1;
+    uint32_t first = bit / 32;
+    uint32_t last  = end / 32;
+    uint32_t head  = 0xFFFFFFFF << (bit % 32);
+    uint32_t tail  = 0xFFFFFFFF >> (31 - (end % 32));
+
+    if (first == last) {
+        bitmap[first] |= head & tail;
+        return;
+    }
+
+    bitmap[first] |= head;
+    memset(&bitmap[first + 1], 0xFF, (last - first - 1) * sizeof(uint32_t));
+    bitmap[last]  |= tail;
+}
+
+void BitmapUnsetRange(uint32_t* bitmap, uint32_t bit, size_t count)
+{
+    if (!count)
+        return;
+
+    uint32_t end   = bit + count - 1;
+    uint32_t first = bit / 32;
+    uint32_t last  = end / 32;
+    uint32_t head  = 0xFFFFFFFF << (bit % 32);
+    uint32_t tail  = 0xFFFFFFFF >> (31 - (end % 32));
+
+    if (first == last) {
+        bitmap[first] &= ~(head & tail);
+        return;
+    }
+
+    bitmap[first] &= ~head;
+    memset(&bitmap[first + 1], 0x00, (last - first - 1) * sizeof(uint32_t));
+    bitmap[last]  &= ~tail;
+}
+
+size_t BitmapCountSet(const uint32_t* bitmap, size_t size)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < size / 32; ++i)
+        count += __builtin_popcount(bitmap[i]);
+
+    if (size % 32)
+        count += __builtin_popcount(bitmap[size / 32] &
+                                    ((1U << (size % 32)) - 1));
+    return count;
+}
+
+/*!
+ * \brief Return \c true if \a value is a non-zero power of two.
+ */
+static bool IsPowerOfTwo(uint32_t value)
+{
+    return value && !(value & (value - 1));
+}
+
+/*!
+ * \brief Round \a value up to a multiple of the power of two \a alignment.
+ */
+static uint32_t AlignUp(uint32_t value, uint32_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+#ifdef COSMO_PFA_BUDDY
+/*!
+ * \brief Return the smallest order whose block holds \a count frames.
+ */
+static uint32_t OrderOf(uint32_t count)
+{
+    uint32_t order = 0;
+    while ((1U << order) < count)
+        order++;
+    return order;
+}
+#endif
+
+/*!
+ * \brief Index of the first frame past each zone.
+ */
+static const uint32_t kZoneEndFrames[PhysicalFrameAllocator::kNumZones] = {
+    PhysicalFrameAllocator::kDmaZoneEnd / PhysicalFrameAllocator::kFrameSize,
+    PhysicalFrameAllocator::kNormalZoneEnd / PhysicalFrameAllocator::kFrameSize,
+    PhysicalFrameAllocator::kHighZoneEnd / PhysicalFrameAllocator::kFrameSize,
+    0xFFFFFFFF
+};
+
+/*!
+ * \brief Return the highest zone the pointer based calls may allocate from.
+ *
+ * Zone::kPae frames lie above 4 GiB and don't fit in a pointer.
+ */
+static int PointerZone(PhysicalFrameAllocator::Zone zone)
+{
+    int z    = static_cast<int>(zone);
+    int high = static_cast<int>(PhysicalFrameAllocator::Zone::kHigh);
+    return (z > high) ? high : z;
+}
+
 PhysicalFrameAllocator::PhysicalFrameAllocator() :
     mem_size_(0),
     max_frames_(0),
     used_frames_(0),
     pmmap_size_(0),
-    pmmap_(nullptr)
+    meta_size_(0),
+    pmmap_(nullptr),
+    num_chunks_(0),
+    chunk_free_(nullptr),
+    descs_(nullptr),
+    policy_(AllocPolicy::kNextFit)
 {
-
+    for (int z = 0; z < kNumZones; ++z) {
+        zones_[z].base        = 0;
+        zones_[z].num_frames  = 0;
+        zones_[z].free_frames = 0;
+        zones_[z].cursor      = 0;
+    }
 }
 
-void PhysicalFrameAllocator::InitRegion(uint32_t base, size_t size)
+void PhysicalFrameAllocator::InitRegion(uint64_t base, uint64_t size)
 {
-    size_t   frames = size / kFrameSize;
-    uint32_t align  = base / kFrameSize;
-    for (size_t i = 0; i < frames; i++) {
-        BitmapUnset(pmmap_, align++);
-        used_frames_--;
-    }
+    /* Shrink the region to the frames it fully contains. */
+    uint64_t start = (base + kFrameSize - 1) >> kFrameShift;
+    uint64_t end   = (base + size) >> kFrameShift;
+    if (end > max_frames_)
+        end = max_frames_;
+    if (start >= end)
+        return;
 
-    BitmapSet(pmmap_, 0);
+    BitmapUnsetRange(pmmap_, start, end - start);
 }
 
-void PhysicalFrameAllocator::FreeRegion(uint32_t base, size_t size)
+void PhysicalFrameAllocator::FreeRegion(uint64_t base, uint64_t size)
 {
-    size_t   frames = (size < kFrameSize) ? 1 : (size / kFrameSize);
-    uint32_t align  = base / kFrameSize;
-    for (size_t i = 0; i < frames; i++) {
-        BitmapSet(pmmap_, align++);
-        used_frames_++;
-    }
+    /* Grow the region to every frame it touches. */
+    uint64_t start = base >> kFrameShift;
+    uint64_t end   = (base + size + kFrameSize - 1) >> kFrameShift;
+    if (end > max_frames_)
+        end = max_frames_;
+    if (start >= end)
+        return;
+
+    BitmapSetRange(pmmap_, start, end - start);
 }
 
 void PhysicalFrameAllocator::InitAvailableRegions(uint32_t mmap_addr,
@@ -84,25 +203,251 @@ void PhysicalFrameAllocator::InitAvailableRegions(uint32_t mmap_addr,
         reinterpret_cast<multiboot_memory_map_t *>(mmap_end_addr);
     while (mmap < mmap_end) {
         if (mmap->type == MULTIBOOT_MEMORY_AVAILABLE) {
-            InitRegion(static_cast<uint32_t>(mmap->addr_low),
-                       static_cast<size_t>(mmap->len_low));
+            InitRegion(
+                (static_cast<uint64_t>(mmap->addr_high) << 32) | mmap->addr_low,
+                (static_cast<uint64_t>(mmap->len_high) << 32) | mmap->len_low);
         }
         mmap++;
     }
 }
 
 void PhysicalFrameAllocator::DeinitKernel(uint32_t kernel_start,
-                                          uint32_t kernel_end)
+                                          uint32_t kernel_end,
+                                          uint32_t meta_start)
 {
-    size_t   kernel_size        = kernel_end - kernel_start;
-    uint32_t pmmap_size_aligned = pmmap_size_;
-    if (!IsAligned(pmmap_size_aligned, kFrameSize))
-        pmmap_size_aligned = Align(pmmap_size_aligned, kFrameSize);
+    size_t   kernel_size       = kernel_end - kernel_start;
+    uint32_t meta_size_aligned = meta_size_;
+    if (!IsAligned(meta_size_aligned, kFrameSize))
+        meta_size_aligned = Align(meta_size_aligned, kFrameSize);
 
     /* No need to align kernel_size since kernel_start/end alignment
-       is done in the link.ld script. */
+       is done in the link.ld script. The allocator's own metadata (bitmap
+       and summary levels) sits after the kernel image and any boot
+       modules. */
     FreeRegion(kernel_start, kernel_size);
-    FreeRegion(kernel_end, pmmap_size_aligned);
+    FreeRegion(meta_start, meta_size_aligned);
+}
+
+void PhysicalFrameAllocator::DeinitModules(const multiboot_info_t* mb_info,
+                                           uint32_t virtual_base)
+{
+    if (!(mb_info->flags & MULTIBOOT_INFO_MODS) || !mb_info->mods_count)
+        return;
+
+    FreeRegion(mb_info->mods_addr,
+               mb_info->mods_count * sizeof(multiboot_module_t));
+
+    const multiboot_module_t* mods =
+        reinterpret_cast<const multiboot_module_t*>(
+            PhysicalToVirtual(mb_info->mods_addr, virtual_base));
+    for (uint32_t i = 0; i < mb_info->mods_count; ++i) {
+        if (mods[i].mod_end > mods[i].mod_start)
+            FreeRegion(mods[i].mod_start, mods[i].mod_end - mods[i].mod_start);
+
+        if (mods[i].cmdline) {
+            const char* cmdline = reinterpret_cast<const char*>(
+                PhysicalToVirtual(mods[i].cmdline, virtual_base));
+            FreeRegion(mods[i].cmdline, strlen(cmdline) + 1);
+        }
+    }
+}
+
+void* PhysicalFrameAllocator::CarveMetadata(size_t bytes)
+{
+    uint8_t* start = reinterpret_cast<uint8_t*>(pmmap_) + meta_size_;
+
+    /* Keep every structure DWORD aligned. */
+    meta_size_ += (bytes + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1);
+    return start;
+}
+
+PhysicalFrameAllocator::FrameZone&
+PhysicalFrameAllocator::ZoneOf(uint32_t frame)
+{
+    /* Empty zones have a base of max_frames_ and are never selected. */
+    int z = kNumZones - 1;
+    while (z && (frame < zones_[z].base))
+        z--;
+    return zones_[z];
+}
+
+void PhysicalFrameAllocator::InitDescriptors()
+{
+    /* Whatever is still in use belongs to the kernel, the allocator or is
+       not RAM at all. Zones start on bitmap word boundaries, so each word
+       covers frames of a single zone. Runs of free or reserved frames fill
+       a whole word of descriptors at once, only mixed words are decoded bit
+       by bit. */
+    for (int z = 0; z < kNumZones; ++z) {
+        FrameDescriptor free_desc = {};
+        free_desc.zone = z;
+        FrameDescriptor reserved_desc = free_desc;
+        reserved_desc.flags = kFrameReserved;
+
+        uint32_t end = zones_[z].base + zones_[z].num_frames;
+        for (uint32_t i = zones_[z].base; i < end; i += kFramesPerDword) {
+            uint32_t word  = pmmap_[i / kFramesPerDword];
+            uint32_t count = end - i;
+            if (count > kFramesPerDword)
+                count = kFramesPerDword;
+
+            if ((0 == word) || (0xFFFFFFFF == word)) {
+                FrameDescriptor desc = word ? reserved_desc : free_desc;
+                for (uint32_t j = 0; j < count; ++j)
+                    descs_[i + j] = desc;
+                continue;
+            }
+
+            for (uint32_t j = 0; j < count; ++j)
+                descs_[i + j] = ((word >> j) & 1) ? reserved_desc : free_desc;
+        }
+    }
+}
+
+void PhysicalFrameAllocator::ResetDescriptors(uint32_t frame, size_t count,
+                                              uint16_t refcount)
+{
+    for (size_t i = 0; i < count; ++i) {
+        FrameDescriptor& desc = descs_[frame + i];
+        desc.refcount = refcount;
+        desc.flags    = 0;
+        desc.owner    = kFrameOwnerNone;
+    }
+}
+
+void PhysicalFrameAllocator::CountChunks()
+{
+    for (size_t i = 0; i < num_chunks_; ++i) {
+        uint32_t first = i * kFramesPerChunk;
+        uint32_t nbits = max_frames_ - first;
+        if (nbits > kFramesPerChunk)
+            nbits = kFramesPerChunk;
+
+        chunk_free_[i] =
+            nbits - BitmapCountSet(pmmap_ + (first / kFramesPerDword), nbits);
+    }
+}
+
+void PhysicalFrameAllocator::AdjustChunks(uint32_t frame, size_t count,
+                                          bool freed)
+{
+    while (count) {
+        size_t chunk = frame / kFramesPerChunk;
+        size_t span  = ((chunk + 1) * kFramesPerChunk) - frame;
+        if (span > count)
+            span = count;
+
+        if (freed)
+            chunk_free_[chunk] += span;
+        else
+            chunk_free_[chunk] -= span;
+
+        frame += span;
+        count -= span;
+    }
+}
+
+void PhysicalFrameAllocator::SeedBuddy(FrameZone& zone)
+{
+    int next = zone.frames.NextUnset(0);
+    while (next != -1) {
+        uint32_t run = zone.frames.UnsetRunLength(next, zone.num_frames);
+        zone.buddy.FreeRange(next, run);
+        next = zone.frames.NextUnset(next + run);
+    }
+}
+
+int PhysicalFrameAllocator::FindFreeRun(const FrameZone& zone, uint32_t count,
+                                        uint32_t step) const
+{
+    int next = zone.frames.NextUnset(0);
+    while (next != -1) {
+        /* Alignment is in terms of physical frame numbers, not zone
+           relative ones. */
+        uint64_t start = AlignUp(zone.base + next, step);
+        if (start < zone.base + static_cast<uint64_t>(next))
+            return -1;
+        start -= zone.base;
+        if ((start >= zone.num_frames) || (count > zone.num_frames - start))
+            return -1;
+
+        uint32_t run = zone.frames.UnsetRunLength(start, count);
+        if (run == count)
+            return static_cast<int>(start);
+
+        /* Frame start+run is in use. Resume the search past it. */
+        next = zone.frames.NextUnset(start + run + 1);
+    }
+    return -1;
+}
+
+int PhysicalFrameAllocator::FindFreeBlock(const FrameZone& zone,
+                                          uint32_t count,
+                                          uint32_t step) const
+{
+    const uint32_t* bitmap = zone.frames.Words();
+    size_t          words  = SummaryBitmap::BitmapWords(zone.num_frames);
+    int             next   = zone.frames.NextUnset(0);
+
+    if (step <= kFramesPerDword) {
+        /* Every candidate block lies within a single DWORD. Fold the free
+           mask onto itself so that bit i survives only if bits
+           [i, i+count) are all free, then keep the aligned positions. */
+        uint32_t aligned = 0;
+        for (uint32_t i = 0; i < kFramesPerDword; i += step)
+            aligned |= 1U << i;
+
+        while (next != -1) {
+            uint32_t word = next / kFramesPerDword;
+            uint32_t free = ~bitmap[word];
+            for (uint32_t shift = 1; shift < count; shift <<= 1)
+                free &= free >> shift;
+            free &= aligned;
+
+            if (free)
+                return (word * kFramesPerDword) + __builtin_ctz(free);
+            next = zone.frames.NextUnset((word + 1) * kFramesPerDword);
+        }
+        return -1;
+    }
+
+    /* Candidate blocks start on DWORD boundaries. Blocks of 32 frames or
+       more must consist of entirely zero DWORDs. Zones start on a DWORD
+       boundary, so only the alignment needs translating to zone relative
+       DWORDs. */
+    uint32_t step_words = step / kFramesPerDword;
+    uint32_t base_word  = zone.base / kFramesPerDword;
+    while (next != -1) {
+        uint32_t word = AlignUp(base_word + (next / kFramesPerDword),
+                                step_words);
+        uint32_t last;
+        bool     free = true;
+
+        if ((word < base_word) || ((word - base_word) >= words))
+            return -1;
+        word -= base_word;
+        last  = word;
+
+        if (count < kFramesPerDword) {
+            free = !(bitmap[word] & ((1U << count) - 1));
+        } else {
+            for (; last < word + (count / kFramesPerDword); ++last) {
+                if (last >= words)
+                    return -1;
+                if (bitmap[last]) {
+                    free = false;
+                    break;
+                }
+            }
+        }
+
+        if (free)
+            return word * kFramesPerDword;
+
+        /* DWORD last holds a used frame. Resume the search past it. */
+        next = zone.frames.NextUnset((last + 1) * kFramesPerDword);
+    }
+    return -1;
 }
 
 PhysicalFrameAllocator& PhysicalFrameAllocator::GetInstance()
@@ -111,6 +456,36 @@ PhysicalFrameAllocator& PhysicalFrameAllocator::GetInstance()
     return allocator;
 }
 
+size_t PhysicalFrameAllocator::GetMemorySize(const multiboot_info_t* mb_info,
+                                             uint32_t virtual_base)
+{
+    if (!(mb_info->flags & MULTIBOOT_INFO_MEM_MAP))
+        return 1024 + mb_info->mem_upper;
+
+    const multiboot_memory_map_t* mmap =
+        reinterpret_cast<const multiboot_memory_map_t*>(
+            mb_info->mmap_addr + virtual_base);
+    const multiboot_memory_map_t* mmap_end =
+        reinterpret_cast<const multiboot_memory_map_t*>(
+            mb_info->mmap_addr + mb_info->mmap_length + virtual_base);
+
+    uint64_t end = 0;
+    for (; mmap < mmap_end; ++mmap) {
+        if (mmap->type != MULTIBOOT_MEMORY_AVAILABLE)
+            continue;
+
+        uint64_t addr = (static_cast<uint64_t>(mmap->addr_high) << 32) |
+                        mmap->addr_low;
+        uint64_t len  = (static_cast<uint64_t>(mmap->len_high) << 32) |
+                        mmap->len_low;
+        if (addr + len > end)
+            end = addr + len;
+    }
+    if (end > kMaxPhysAddr)
+        end = kMaxPhysAddr;
+    return static_cast<size_t>(end / 1024);
+}
+
 void PhysicalFrameAllocator::Init(const multiboot_info_t* mb_info,
                                   uint32_t pmmap_addr,
                                   size_t pmmap_size,
@@ -124,16 +499,61 @@ void PhysicalFrameAllocator::Init(const multiboot_info_t* mb_info,
     used_frames_ = max_frames_;
     pmmap_       =
         reinterpret_cast<uint32_t*>(
-            PhysicalToVirtual(pmmap_addr, kernel_desc.kernel_virtual_start));
+            PhysicalToVirtual(pmmap_addr, kernel_desc.kernel_virtual_base));
 
     pmmap_size_ = max_frames_ / kFramesPerDword;
     if (max_frames_ % kFramesPerDword)
         pmmap_size_++;
 
+    /* Lay out the allocator metadata behind the bitmap: per zone summary
+       levels, per chunk free counts, per frame descriptors and, in buddy
+       builds, the per zone buddy order bitmaps. Zones that lie beyond the
+       end of memory are empty. */
+    meta_size_ = 0;
+    CarveMetadata(pmmap_size_ * sizeof(uint32_t));
+
+    uint32_t* summary[kNumZones];
+    uint32_t  zone_start = 0;
+    for (int z = 0; z < kNumZones; ++z) {
+        uint32_t zone_end = kZoneEndFrames[z];
+        if (zone_end > max_frames_)
+            zone_end = max_frames_;
+
+        zones_[z].base       = zone_start;
+        zones_[z].num_frames = zone_end - zone_start;
+        zones_[z].cursor     = 0;
+        summary[z]           =
+            static_cast<uint32_t*>(
+                CarveMetadata(SummaryBitmap::SummaryWords(zones_[z].num_frames) *
+                              sizeof(uint32_t)));
+        zone_start = zone_end;
+    }
+
+    num_chunks_  = (max_frames_ + kFramesPerChunk - 1) / kFramesPerChunk;
+    chunk_free_  =
+        static_cast<uint16_t*>(CarveMetadata(num_chunks_ * sizeof(uint16_t)));
+    descs_       =
+        static_cast<FrameDescriptor*>(
+            CarveMetadata(max_frames_ * sizeof(FrameDescriptor)));
+#ifdef COSMO_PFA_BUDDY
+    uint32_t* buddy_storage[kNumZones];
+    for (int z = 0; z < kNumZones; ++z) {
+        buddy_storage[z] =
+            static_cast<uint32_t*>(
+                CarveMetadata(
+                    BuddyAllocator::StorageWords(zones_[z].num_frames) *
+                    sizeof(uint32_t)));
+    }
+#endif
+
     /* Set all bits in the bitmap to 1 (i.e., mark all of memory as in
        use. Subsequently, we will free memory as directed by the Multiboot
        info we recved from GRUB. */
-    memset(pmmap_, 0xFF, pmmap_size_);
+    memset(pmmap_, 0xFF, pmmap_size_ * sizeof(uint32_t));
+    for (int z = 0; z < kNumZones; ++z) {
+        zones_[z].frames.Init(pmmap_ + (zones_[z].base / kFramesPerDword),
+                              summary[z], zones_[z].num_frames);
+    }
 
     /* Initialize (i.e., mark as ready for use) those frames indicated
        as available by the Multiboot multiboot_memory_map_t structs. */
@@ -144,36 +564,288 @@ void PhysicalFrameAllocator::Init(const multiboot_info_t* mb_info,
 
     /* Mark kernel frames as in use. */
     DeinitKernel(kernel_desc.kernel_physical_start,
-                 kernel_desc.kernel_physical_end);
+                 kernel_desc.kernel_physical_end,
+                 pmmap_addr);
+
+    /* Mark boot modules (e.g. the initrd) as in use. */
+    DeinitModules(mb_info, kernel_desc.kernel_virtual_base);
+
+    /* Frame 0 is never handed out so that a valid frame can't be confused
+       with nullptr. */
+    BitmapSet(pmmap_, 0);
+
+    /* The bitmap is final, summarize each zone for AllocFrame() and count
+       the frames that remain in use. */
+    for (int z = 0; z < kNumZones; ++z) {
+        FrameZone& zone = zones_[z];
+        zone.frames.Rebuild();
+        zone.free_frames = zone.num_frames -
+                           BitmapCountSet(zone.frames.Words(), zone.num_frames);
+    }
+    used_frames_ = BitmapCountSet(pmmap_, max_frames_);
+    CountChunks();
+    InitDescriptors();
+
+#ifdef COSMO_PFA_BUDDY
+    /* Seed the buddy lists with the frames the Multiboot map (less the
+       kernel and allocator metadata) left free. */
+    for (int z = 0; z < kNumZones; ++z) {
+        zones_[z].buddy.Init(buddy_storage[z], zones_[z].num_frames);
+        SeedBuddy(zones_[z]);
+    }
+#endif
 }
 
-void* PhysicalFrameAllocator::AllocFrame()
+int PhysicalFrameAllocator::AllocZoneFrame(FrameZone& zone)
 {
-    if (used_frames_ - max_frames_ <= 0)
-        /* Uses properties of unsigned integers to detect allocation limit. */
-        return nullptr;
+    if (!zone.free_frames)
+        return -1;
 
-    int p_index = BitmapFirstUnset(pmmap_, max_frames_);
+#ifdef COSMO_PFA_BUDDY
+    int p_index = zone.buddy.AllocBlock(0);
+#else
+    /* Next fit resumes where the last allocation left off so the exhausted
+       low frames are not revisited. The summary levels skip over full
+       chunks, wrapping around to the first frame when the end is hit. */
+    int p_index = -1;
+    if (AllocPolicy::kNextFit == policy_)
+        p_index = zone.frames.NextUnset(zone.cursor);
     if (-1 == p_index)
-        return nullptr;
+        p_index = zone.frames.FirstUnset();
+#endif
+    if (-1 == p_index)
+        return -1;
 
-    BitmapSet(pmmap_, p_index);
+    zone.frames.Set(p_index);
+    zone.free_frames--;
+    zone.cursor = p_index + 1;
+
+    p_index += zone.base;
     used_frames_++;
+    chunk_free_[p_index / kFramesPerChunk]--;
+    ResetDescriptors(p_index, 1, 1);
+    return p_index;
+}
+
+void* PhysicalFrameAllocator::AllocFrame(Zone zone)
+{
+    /* Lower zones are only used once the preferred zone is exhausted. */
+    for (int z = PointerZone(zone); z >= 0; --z) {
+        int p_index = AllocZoneFrame(zones_[z]);
+        if (-1 != p_index)
+            return reinterpret_cast<void *>(kFrameSize * p_index);
+    }
+    return nullptr;
+}
 
-    return reinterpret_cast<void *>(kFrameSize * p_index);
+PhysAddr PhysicalFrameAllocator::AllocPhysFrame(Zone zone)
+{
+    for (int z = static_cast<int>(zone); z >= 0; --z) {
+        int p_index = AllocZoneFrame(zones_[z]);
+        if (-1 != p_index)
+            return static_cast<PhysAddr>(p_index) << kFrameShift;
+    }
+    return 0;
 }
 
-void PhysicalFrameAllocator::FreeFrame(void* frame)
+void PhysicalFrameAllocator::FreeFrame(PhysAddr frame)
 {
     if (!frame)
         /* NOOP if given a NULL frame. */
         return;
 
-    uint32_t frame_addr = reinterpret_cast<uintptr_t>(frame);
-
-    int index = frame_addr / kFrameSize;
-    BitmapUnset(pmmap_, index);
+    uint32_t   index = FrameIndex(frame);
+    FrameZone& zone  = ZoneOf(index);
+    zone.frames.Unset(index - zone.base);
+#ifdef COSMO_PFA_BUDDY
+    zone.buddy.FreeBlock(index - zone.base, 0);
+#endif
+    zone.free_frames++;
     used_frames_--;
+    chunk_free_[index / kFramesPerChunk]++;
+    ResetDescriptors(index, 1, 0);
+}
+
+size_t PhysicalFrameAllocator::AllocZoneBatch(FrameZone& zone, void** frames,
+                                              size_t count)
+{
+    size_t   allocated = 0;
+    uint32_t cursor    = (AllocPolicy::kNextFit == policy_) ? zone.cursor : 0;
+#ifndef COSMO_PFA_BUDDY
+    bool     wrapped   = (0 == cursor);
+#endif
+
+    while ((allocated < count) && (allocated < zone.free_frames)) {
+#ifdef COSMO_PFA_BUDDY
+        int p_index = zone.buddy.AllocBlock(0);
+#else
+        int p_index = zone.frames.NextUnset(cursor);
+        if ((-1 == p_index) && !wrapped) {
+            wrapped = true;
+            p_index = zone.frames.FirstUnset();
+        }
+#endif
+        if (-1 == p_index)
+            break;
+
+        zone.frames.Set(p_index);
+        cursor   = p_index + 1;
+        p_index += zone.base;
+        chunk_free_[p_index / kFramesPerChunk]--;
+        ResetDescriptors(p_index, 1, 1);
+
+        frames[allocated++] = reinterpret_cast<void *>(kFrameSize * p_index);
+    }
+
+    zone.free_frames -= allocated;
+    zone.cursor       = cursor;
+    used_frames_     += allocated;
+    return allocated;
+}
+
+size_t PhysicalFrameAllocator::AllocFrameBatch(void** frames, size_t count,
+                                               Zone zone)
+{
+    size_t allocated = 0;
+    for (int z = PointerZone(zone); (z >= 0) && (allocated < count); --z)
+        allocated += AllocZoneBatch(zones_[z], frames + allocated,
+                                    count - allocated);
+    return allocated;
+}
+
+void PhysicalFrameAllocator::FreeFrameBatch(void* const* frames, size_t count)
+{
+    size_t freed = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (!frames[i])
+            continue;
+
+        uint32_t   index = FrameIndex(ToPhysAddr(frames[i]));
+        FrameZone& zone  = ZoneOf(index);
+        zone.frames.Unset(index - zone.base);
+#ifdef COSMO_PFA_BUDDY
+        zone.buddy.FreeBlock(index - zone.base, 0);
+#endif
+        zone.free_frames++;
+        chunk_free_[index / kFramesPerChunk]++;
+        ResetDescriptors(index, 1, 0);
+        freed++;
+    }
+    used_frames_ -= freed;
+}
+
+int PhysicalFrameAllocator::AllocZoneFrames(FrameZone& zone, uint32_t count,
+                                            uint32_t step)
+{
+    if (count > zone.free_frames)
+        return -1;
+
+    int start = -1;
+
+#ifdef COSMO_PFA_BUDDY
+    /* A block of order k is 2^k aligned. Take the smallest block that
+       satisfies both the count and the alignment, then give the frames past
+       count back to the buddy lists. Zone bases are aligned well beyond the
+       largest block, so zone relative alignment is physical alignment. */
+    uint32_t order = OrderOf((count > step) ? count : step);
+    start = zone.buddy.AllocBlock(order);
+    if (-1 == start)
+        return -1;
+    zone.buddy.FreeRange(start + count,
+                         (static_cast<size_t>(1) << order) - count);
+#else
+    /* Power of two counts first try a naturally aligned block. That block
+       satisfies any weaker alignment, so the general run search is only
+       needed when the caller asked for less than natural alignment. */
+    bool pow2 = IsPowerOfTwo(count);
+    if (pow2)
+        start = FindFreeBlock(zone, count, (step > count) ? step : count);
+    if ((-1 == start) && (!pow2 || (step < count)))
+        start = FindFreeRun(zone, count, step);
+
+    if (-1 == start)
+        return -1;
+#endif
+
+    zone.frames.SetRange(start, count);
+    zone.free_frames -= count;
+
+    start += zone.base;
+    used_frames_ += count;
+    AdjustChunks(start, count, false);
+    ResetDescriptors(start, count, 1);
+    return start;
+}
+
+void* PhysicalFrameAllocator::AllocFrames(size_t count, uint32_t alignment,
+                                         Zone zone)
+{
+    if (!count || !IsPowerOfTwo(alignment))
+        return nullptr;
+
+    if (count > max_frames_ - used_frames_)
+        return nullptr;
+
+    uint32_t step = (alignment < kFrameSize) ? 1 : (alignment / kFrameSize);
+    for (int z = PointerZone(zone); z >= 0; --z) {
+        int start = AllocZoneFrames(zones_[z], count, step);
+        if (-1 != start)
+            return reinterpret_cast<void *>(kFrameSize * start);
+    }
+    return nullptr;
+}
+
+void PhysicalFrameAllocator::FreeFrames(void* frames, size_t count)
+{
+    if (!frames)
+        /* NOOP if given a NULL frame. */
+        return;
+
+    /* AllocFrames() never returns a run that straddles two zones. */
+    uint32_t   index = FrameIndex(ToPhysAddr(frames));
+    FrameZone& zone  = ZoneOf(index);
+    zone.frames.UnsetRange(index - zone.base, count);
+#ifdef COSMO_PFA_BUDDY
+    zone.buddy.FreeRange(index - zone.base, count);
+#endif
+    zone.free_frames += count;
+    used_frames_     -= count;
+    AdjustChunks(index, count, true);
+    ResetDescriptors(index, count, 0);
+}
+
+FrameDescriptor* PhysicalFrameAllocator::GetDescriptor(PhysAddr frame)
+{
+    uint64_t index = frame >> kFrameShift;
+    return (index < max_frames_) ? &descs_[index] : nullptr;
+}
+
+bool PhysicalFrameAllocator::GetFrame(PhysAddr frame)
+{
+    FrameDescriptor* desc = GetDescriptor(frame);
+    if (!desc || !desc->refcount || (0xFFFF == desc->refcount))
+        return false;
+
+    desc->refcount++;
+    desc->flags |= kFrameShared;
+    return true;
+}
+
+bool PhysicalFrameAllocator::PutFrame(PhysAddr frame)
+{
+    FrameDescriptor* desc = GetDescriptor(frame);
+    if (!desc || !desc->refcount)
+        return false;
+
+    if (--desc->refcount) {
+        if (1 == desc->refcount)
+            desc->flags &= ~kFrameShared;
+        return false;
+    }
+
+    /* The last reference is gone. FreeFrame() resets the descriptor. */
+    FreeFrame(frame);
+    return true;
 }
 } // end vmem
 } // end cosmo
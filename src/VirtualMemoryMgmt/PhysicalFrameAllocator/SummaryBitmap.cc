@@ -0,0 +1,207 @@
+#include <stdint.h>
+#include <stddef.h>
+
+#include "SummaryBitmap.h"
+#include "PhysicalFrameAllocator.h"
+
+namespace cosmo
+{
+namespace vmem
+{
+static const uint32_t kFullWord = 0xFFFFFFFF;
+
+SummaryBitmap::SummaryBitmap() :
+    num_levels_(0),
+    nbits_(0)
+{
+    for (int i = 0; i < kMaxLevels; ++i) {
+        levels_[i] = nullptr;
+        words_[i]  = 0;
+    }
+}
+
+size_t SummaryBitmap::SummaryWords(size_t nbits)
+{
+    size_t total = 0;
+    size_t words = BitmapWords(nbits);
+    while (words > 1) {
+        words  = BitmapWords(words);
+        total += words;
+    }
+    return total;
+}
+
+void SummaryBitmap::Init(uint32_t* bitmap, uint32_t* summary, size_t nbits)
+{
+    nbits_      = nbits;
+    num_levels_ = 1;
+    levels_[0]  = bitmap;
+    words_[0]   = BitmapWords(nbits);
+
+    /* Carve the summary levels out of the scratch space. Each level holds
+       one bit per DWORD of the level below it. */
+    while ((words_[num_levels_ - 1] > 1) && (num_levels_ < kMaxLevels)) {
+        words_[num_levels_]  = BitmapWords(words_[num_levels_ - 1]);
+        levels_[num_levels_] = summary;
+        summary             += words_[num_levels_];
+        num_levels_++;
+    }
+
+    /* Bits beyond the end of the bitmap are permanently in use. */
+    uint32_t rem_bits = nbits % kBitsPerWord;
+    if (rem_bits)
+        levels_[0][words_[0] - 1] |= kFullWord << rem_bits;
+}
+
+void SummaryBitmap::Rebuild()
+{
+    for (int l = 1; l < num_levels_; ++l) {
+        const uint32_t* below = levels_[l - 1];
+        uint32_t*       level = levels_[l];
+        for (size_t i = 0; i < words_[l]; ++i) {
+            /* Summary bits with no DWORD below them stay set. */
+            uint32_t word = kFullWord;
+            for (uint32_t j = 0; j < kBitsPerWord; ++j) {
+                size_t k = (i * kBitsPerWord) + j;
+                if ((k < words_[l - 1]) && (below[k] != kFullWord))
+                    word &= ~(1U << j);
+            }
+            level[i] = word;
+        }
+    }
+}
+
+void SummaryBitmap::Set(uint32_t bit)
+{
+    for (int l = 0; l < num_levels_; ++l) {
+        uint32_t& word = levels_[l][bit / kBitsPerWord];
+        word |= 1U << (bit % kBitsPerWord);
+
+        /* The summary only changes when this DWORD just became full. */
+        if (word != kFullWord)
+            return;
+        bit /= kBitsPerWord;
+    }
+}
+
+void SummaryBitmap::Unset(uint32_t bit)
+{
+    for (int l = 0; l < num_levels_; ++l) {
+        uint32_t& word     = levels_[l][bit / kBitsPerWord];
+        bool      was_full = (word == kFullWord);
+        word &= ~(1U << (bit % kBitsPerWord));
+
+        /* The summary only changes when this DWORD was previously full. */
+        if (!was_full)
+            return;
+        bit /= kBitsPerWord;
+    }
+}
+
+void SummaryBitmap::SetRange(uint32_t bit, size_t count)
+{
+    for (int l = 0; (l < num_levels_) && count; ++l) {
+        uint32_t first = bit / kBitsPerWord;
+        uint32_t last  = (bit + count - 1) / kBitsPerWord;
+        BitmapSetRange(levels_[l], bit, count);
+
+        /* Inner DWORDs are now full. The edge DWORDs are full only if the
+           bits outside the range were already set. */
+        if (levels_[l][first] != kFullWord)
+            first++;
+        if ((last >= first) && (levels_[l][last] != kFullWord))
+            last--;
+        if ((last + 1) <= first)
+            return;
+
+        bit   = first;
+        count = last - first + 1;
+    }
+}
+
+void SummaryBitmap::UnsetRange(uint32_t bit, size_t count)
+{
+    for (int l = 0; (l < num_levels_) && count; ++l) {
+        uint32_t first = bit / kBitsPerWord;
+        uint32_t last  = (bit + count - 1) / kBitsPerWord;
+        BitmapUnsetRange(levels_[l], bit, count);
+
+        bit   = first;
+        count = last - first + 1;
+    }
+}
+
+int SummaryBitmap::FirstUnset() const
+{
+    if (!num_levels_ || !nbits_)
+        return -1;
+
+    /* The top level is a single DWORD. A full top level means every bit
+       in the bitmap is set. */
+    uint32_t top = levels_[num_levels_ - 1][0];
+    if (top == kFullWord)
+        return -1;
+
+    /* Walk down the levels, each step selecting the first DWORD below that
+       still has a clear bit. */
+    uint32_t index = __builtin_ctz(~top);
+    for (int l = num_levels_ - 2; l >= 0; --l)
+        index = (index * kBitsPerWord) + __builtin_ctz(~levels_[l][index]);
+
+    return static_cast<int>(index);
+}
+
+int SummaryBitmap::NextUnset(uint32_t bit) const
+{
+    if (bit >= nbits_)
+        return -1;
+
+    /* Climb the levels until a DWORD with a clear bit at or after the
+       current position is found. Bits below the position are masked off
+       as if they were in use. */
+    int      l     = 0;
+    uint32_t index = bit;
+    for (;;) {
+        if ((index / kBitsPerWord) >= words_[l])
+            return -1;
+
+        uint32_t word = levels_[l][index / kBitsPerWord] |
+                        ((1U << (index % kBitsPerWord)) - 1);
+        if (word != kFullWord) {
+            index = (index & ~(kBitsPerWord - 1)) + __builtin_ctz(~word);
+            break;
+        }
+
+        if (++l == num_levels_)
+            return -1;
+        index = (index / kBitsPerWord) + 1;
+    }
+
+    /* Walk back down selecting the first DWORD with a clear bit. */
+    while (l-- > 0)
+        index = (index * kBitsPerWord) + __builtin_ctz(~levels_[l][index]);
+
+    return static_cast<int>(index);
+}
+
+uint32_t SummaryBitmap::UnsetRunLength(uint32_t bit, uint32_t max_len) const
+{
+    uint32_t len = 0;
+    while ((len < max_len) && (bit < nbits_)) {
+        uint32_t offset = bit % kBitsPerWord;
+        uint32_t avail  = kBitsPerWord - offset;
+        uint32_t word   = levels_[0][bit / kBitsPerWord] >> offset;
+
+        /* A zero word contributes all of its remaining bits. Otherwise the
+           run ends at the lowest set bit. */
+        if (word) {
+            len += __builtin_ctz(word);
+            break;
+        }
+        len += avail;
+        bit += avail;
+    }
+    return (len < max_len) ? len : max_len;
+}
+} // end vmem
+} // end cosmo
@@ -0,0 +1,114 @@
+#include <stdint.h>
+#include <stddef.h>
+
+#include "Cpu.h"
+#include "FrameMagazine.h"
+#include "PhysicalFrameAllocator.h"
+#include "PhysMap.h"
+#include "ZeroedFramePool.h"
+
+namespace cosmo
+{
+namespace vmem
+{
+ZeroedFramePool::ZeroedFramePool() :
+    count_(0),
+    hits_(0),
+    misses_(0),
+    has_movnti_(false)
+{
+    cpu::CpuidRegs regs = cpu::Cpuid(cpu::kCpuidFeatureLeaf);
+    has_movnti_ = regs.edx & cpu::kCpuidEdxSse2;
+}
+
+ZeroedFramePool& ZeroedFramePool::GetInstance()
+{
+    static ZeroedFramePool pool;
+    return pool;
+}
+
+void ZeroedFramePool::ZeroFrame(uint32_t frame, bool non_temporal)
+{
+    uint32_t* dst   = static_cast<uint32_t*>(PhysToVirt(frame));
+    uint32_t  words = PhysicalFrameAllocator::kFrameSize / sizeof(uint32_t);
+
+    if (non_temporal && has_movnti_) {
+        /* movnti writes around the cache. The sfence orders the weakly
+           ordered stores before the frame is published. */
+        for (uint32_t i = 0; i < words; i += 4) {
+            __asm__ volatile("movnti %1, 0(%0)\n\t"
+                             "movnti %1, 4(%0)\n\t"
+                             "movnti %1, 8(%0)\n\t"
+                             "movnti %1, 12(%0)"
+                             :
+                             : "r"(dst + i), "r"(0)
+                             : "memory");
+        }
+        __asm__ volatile("sfence" ::: "memory");
+        return;
+    }
+
+    __asm__ volatile("rep stosl"
+                     : "+D"(dst), "+c"(words)
+                     : "a"(0)
+                     : "memory");
+}
+
+void* ZeroedFramePool::AllocZeroedFrame()
+{
+    {
+        cpu::InterruptGuard guard;
+
+        if (count_) {
+            hits_++;
+            return frames_[--count_];
+        }
+        misses_++;
+    }
+
+    /* A recently freed frame from the magazine is likely still cached, which
+       pays off when it is zeroed with regular stores. The frame is private
+       until it is returned, so it is zeroed with interrupts enabled. */
+    void* frame = PageMagazine::GetInstance().AllocFrame();
+    if (frame)
+        ZeroFrame(reinterpret_cast<uintptr_t>(frame), false);
+    return frame;
+}
+
+bool ZeroedFramePool::FillOne()
+{
+    PageMagazine& magazine = PageMagazine::GetInstance();
+
+    {
+        cpu::InterruptGuard guard;
+
+        if (kCapacity == count_)
+            return false;
+    }
+
+    void* frame = magazine.AllocFrame();
+    if (!frame)
+        return false;
+
+    /* Zeroing a frame takes a few microseconds, keep interrupts enabled
+       meanwhile. The pool may have been filled by the time the frame is
+       ready, so the capacity is checked again before pushing it. */
+    ZeroFrame(reinterpret_cast<uintptr_t>(frame), true);
+
+    cpu::InterruptGuard guard;
+
+    if (kCapacity == count_) {
+        magazine.FreeFrame(frame);
+        return false;
+    }
+    frames_[count_++] = frame;
+    return true;
+}
+
+uint32_t ZeroedFramePool::GetHitRate() const
+{
+    uint32_t total = hits_ + misses_;
+    return total ? ((hits_ * 100) / total) : 0;
+}
+} // end vmem
+} // end cosmo
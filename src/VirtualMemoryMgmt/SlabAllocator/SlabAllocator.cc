@@ -0,0 +1,271 @@
+#include <stdint.h>
+#include <stddef.h>
+
+#include "Cpu.h"
+#include "PhysicalFrameAllocator.h"
+#include "PhysMap.h"
+#include "SlabAllocator.h"
+
+namespace cosmo
+{
+namespace vmem
+{
+static const size_t kPageSize     = PhysicalFrameAllocator::kFrameSize;
+static const size_t kMaxSlabPages = SlabAllocator::kSlabSpan / kPageSize;
+
+SlabCache::SlabCache(const char* name, size_t object_size, size_t align) :
+    name_(name),
+    object_size_(0),
+    pages_per_slab_(0),
+    objects_per_slab_(0),
+    first_object_(0),
+    partial_(nullptr),
+    full_(nullptr),
+    empty_(nullptr),
+    num_slabs_(0),
+    in_use_(0),
+    next_(nullptr)
+{
+    if (object_size < kMinObjectSize)
+        object_size = kMinObjectSize;
+
+    /* Align to the object size rounded up to a power of two, at most a
+       cache line. */
+    size_t natural = kCacheLine;
+    while ((natural / 2) >= object_size)
+        natural /= 2;
+    if (align < natural)
+        align = natural;
+
+    object_size_  = (object_size + align - 1) & ~(align - 1);
+    first_object_ = (sizeof(Slab) + align - 1) & ~(align - 1);
+
+    /* Use the smallest slab that wastes at most an eighth of its size. */
+    size_t pages = 1;
+    for (; pages < kMaxSlabPages; pages *= 2) {
+        size_t waste = ((pages * kPageSize) - first_object_) % object_size_;
+        if ((waste * 8) <= (pages * kPageSize))
+            break;
+    }
+    pages_per_slab_   = pages;
+    objects_per_slab_ = ((pages * kPageSize) - first_object_) / object_size_;
+}
+
+SlabCache::Slab* SlabCache::SlabOf(void* obj)
+{
+    uintptr_t addr = reinterpret_cast<uintptr_t>(obj);
+    return reinterpret_cast<Slab*>(addr & ~(SlabAllocator::kSlabSpan - 1));
+}
+
+SlabCache::Slab** SlabCache::ListOf(const Slab* slab)
+{
+    if (!slab->in_use)
+        return &empty_;
+    return (objects_per_slab_ == slab->in_use) ? &full_ : &partial_;
+}
+
+void SlabCache::ListPush(Slab** list, Slab* slab)
+{
+    slab->prev = nullptr;
+    slab->next = *list;
+    if (*list)
+        (*list)->prev = slab;
+    *list = slab;
+}
+
+void SlabCache::ListRemove(Slab** list, Slab* slab)
+{
+    if (slab->prev)
+        slab->prev->next = slab->next;
+    else
+        *list = slab->next;
+
+    if (slab->next)
+        slab->next->prev = slab->prev;
+}
+
+SlabCache::Slab* SlabCache::Grow()
+{
+    if (!objects_per_slab_)
+        return nullptr;
+
+    Slab* slab = static_cast<Slab*>(
+        SlabAllocator::GetInstance().AllocSlab(pages_per_slab_));
+    if (!slab)
+        return nullptr;
+
+    slab->cache     = this;
+    slab->free_list = nullptr;
+    slab->in_use    = 0;
+    slab->unused    = 0;
+    ListPush(&empty_, slab);
+    num_slabs_++;
+    return slab;
+}
+
+void* SlabCache::Alloc()
+{
+    cpu::InterruptGuard guard;
+
+    Slab* slab = partial_ ? partial_ : empty_;
+    if (!slab) {
+        slab = Grow();
+        if (!slab)
+            return nullptr;
+    }
+
+    void* obj = slab->free_list;
+    if (obj) {
+        slab->free_list = *static_cast<void**>(obj);
+    } else {
+        obj = reinterpret_cast<uint8_t*>(slab) + first_object_ +
+              (slab->unused * object_size_);
+        slab->unused++;
+    }
+
+    Slab** from = ListOf(slab);
+    slab->in_use++;
+    Slab** to = ListOf(slab);
+    if (from != to) {
+        ListRemove(from, slab);
+        ListPush(to, slab);
+    }
+    in_use_++;
+    return obj;
+}
+
+void SlabCache::Free(void* obj)
+{
+    cpu::InterruptGuard guard;
+
+    Slab* slab = SlabOf(obj);
+    *static_cast<void**>(obj) = slab->free_list;
+    slab->free_list = obj;
+
+    Slab** from = ListOf(slab);
+    slab->in_use--;
+    Slab** to = ListOf(slab);
+    if (from != to) {
+        ListRemove(from, slab);
+        ListPush(to, slab);
+    }
+    in_use_--;
+
+    /* Keep one empty slab around so a cache hovering around a slab boundary
+       does not map and unmap a slab on every call. */
+    if ((&empty_ == to) && slab->next) {
+        ListRemove(&empty_, slab);
+        num_slabs_--;
+        SlabAllocator::GetInstance().FreeSlab(slab, pages_per_slab_);
+    }
+}
+
+SlabCacheStats SlabCache::GetStats() const
+{
+    cpu::InterruptGuard guard;
+
+    SlabCacheStats stats;
+    stats.name             = name_;
+    stats.object_size      = object_size_;
+    stats.objects_per_slab = objects_per_slab_;
+    stats.slabs            = num_slabs_;
+    stats.objects_total    = num_slabs_ * objects_per_slab_;
+    stats.objects_in_use   = in_use_;
+    stats.bytes            = num_slabs_ * pages_per_slab_ * kPageSize;
+    return stats;
+}
+
+uint32_t SlabCache::GetUtilization() const
+{
+    size_t total = num_slabs_ * objects_per_slab_;
+    return total ? ((in_use_ * 100) / total) : 0;
+}
+
+SlabAllocator& SlabAllocator::GetInstance()
+{
+    static SlabAllocator slab_alloc;
+    return slab_alloc;
+}
+
+SlabAllocator::SlabAllocator() :
+    size_caches_{
+        {"kmalloc-16",   16,   16},
+        {"kmalloc-32",   32,   32},
+        {"kmalloc-64",   64,   64},
+        {"kmalloc-128",  128,  64},
+        {"kmalloc-256",  256,  64},
+        {"kmalloc-512",  512,  64},
+        {"kmalloc-1024", 1024, 64},
+        {"kmalloc-2048", 2048, 64}
+    },
+    caches_(nullptr)
+{
+    /* Register in reverse so the size classes are walked smallest first. */
+    for (size_t i = kNumSizeClasses; i--; )
+        RegisterCache(&size_caches_[i]);
+}
+
+void SlabAllocator::RegisterCache(SlabCache* cache)
+{
+    cpu::InterruptGuard guard;
+    cache->next_ = caches_;
+    caches_      = cache;
+}
+
+void* SlabAllocator::AllocSlab(size_t pages)
+{
+    /* Slabs of every size are kSlabSpan aligned so that the header of any
+       slab is found by masking an object address. */
+    PhysicalFrameAllocator& falloc = PhysicalFrameAllocator::GetInstance();
+    void* frames = falloc.AllocFrames(pages, kSlabSpan);
+    if (!frames)
+        return nullptr;
+
+    uint8_t* frame = static_cast<uint8_t*>(frames);
+    for (size_t i = 0; i < pages; ++i)
+        falloc.GetDescriptor(frame + (i * kPageSize))->owner = kFrameOwnerSlab;
+    return PhysToVirt(frames);
+}
+
+void SlabAllocator::FreeSlab(void* slab, size_t pages)
+{
+    PhysicalFrameAllocator::GetInstance().FreeFrames(
+        reinterpret_cast<void*>(VirtToPhys(slab)), pages);
+}
+
+void* SlabAllocator::Alloc(size_t size)
+{
+    if (!size || (size > SlabCache::kMaxObjectSize))
+        return nullptr;
+
+    /* Index of the smallest power of two size class holding size. */
+    size_t index = 0;
+    if (size > SlabCache::kMinObjectSize)
+        index = 32 - __builtin_clz(size - 1) - 4;
+    return size_caches_[index].Alloc();
+}
+
+void SlabAllocator::Free(void* ptr)
+{
+    if (!ptr || !IsPhysMapAddress(ptr))
+        return;
+
+    FrameDescriptor* desc = PhysicalFrameAllocator::GetInstance().GetDescriptor(
+        reinterpret_cast<void*>(VirtToPhys(ptr)));
+    if (!desc || (kFrameOwnerSlab != desc->owner))
+        return;
+
+    SlabCache::SlabOf(ptr)->cache->Free(ptr);
+}
+
+void* kmalloc(size_t size)
+{
+    return SlabAllocator::GetInstance().Alloc(size);
+}
+
+void kfree(void* ptr)
+{
+    SlabAllocator::GetInstance().Free(ptr);
+}
+} // end vmem
+} // end cosmo
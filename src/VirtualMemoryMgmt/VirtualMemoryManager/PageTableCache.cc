@@ -0,0 +1,96 @@
+#include <stdint.h>
+#include <stddef.h>
+
+#include "Cpu.h"
+#include "FrameMagazine.h"
+#include "PhysicalFrameAllocator.h"
+#include "ZeroedFramePool.h"
+#include "PageTableCache.h"
+
+namespace cosmo
+{
+namespace vmem
+{
+PageTableCache& PageTableCache::GetInstance()
+{
+    static PageTableCache cache;
+    return cache;
+}
+
+bool PageTableCache::Alloc(void** tables, size_t count)
+{
+    PhysicalFrameAllocator& falloc  = PhysicalFrameAllocator::GetInstance();
+    size_t                  cached  = 0;
+    size_t                  missing = 0;
+
+    {
+        cpu::InterruptGuard guard;
+
+        cached  = (count < count_) ? count : count_;
+        missing = count - cached;
+
+        /* Fetch everything the cache can't cover in one call: a single table
+           from the PageMagazine, several with one allocator batch. */
+        if (1 == missing) {
+            tables[cached] = PageMagazine::GetInstance().AllocFrame();
+            batches_++;
+            if (!tables[cached])
+                return false;
+        } else if (missing) {
+            size_t got = falloc.AllocFrameBatch(tables + cached, missing);
+            batches_++;
+            if (got != missing) {
+                falloc.FreeFrameBatch(tables + cached, got);
+                return false;
+            }
+        }
+
+        for (size_t i = 0; i < cached; ++i)
+            tables[i] = frames_[--count_];
+        hits_   += cached;
+        misses_ += missing;
+    }
+
+    /* The frames are private now, so the fresh ones are zeroed with
+       interrupts enabled. The tables are written right after, so zero them
+       with regular stores. */
+    ZeroedFramePool& zero_pool = ZeroedFramePool::GetInstance();
+    for (size_t i = cached; i < count; ++i)
+        zero_pool.ZeroFrame(reinterpret_cast<uintptr_t>(tables[i]), false);
+
+    for (size_t i = 0; i < count; ++i)
+        falloc.GetDescriptor(tables[i])->owner = kFrameOwnerPageTable;
+    return true;
+}
+
+bool PageTableCache::FillOne()
+{
+    PageMagazine& magazine = PageMagazine::GetInstance();
+
+    {
+        cpu::InterruptGuard guard;
+
+        if (kCapacity == count_)
+            return false;
+    }
+
+    void* frame = magazine.AllocFrame();
+    if (!frame)
+        return false;
+
+    /* Zero with interrupts enabled and check the capacity again before
+       pushing the frame, the cache may have been filled meanwhile. */
+    ZeroedFramePool::GetInstance().ZeroFrame(reinterpret_cast<uintptr_t>(frame),
+                                             true);
+
+    cpu::InterruptGuard guard;
+
+    if (kCapacity == count_) {
+        magazine.FreeFrame(frame);
+        return false;
+    }
+    frames_[count_++] = frame;
+    return true;
+}
+} // end vmem
+} // end cosmo
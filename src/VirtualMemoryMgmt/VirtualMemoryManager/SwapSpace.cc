@@ -0,0 +1,81 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "PhysicalFrameAllocator.h"
+#include "PhysMap.h"
+#include "SwapSpace.h"
+
+namespace cosmo
+{
+namespace vmem
+{
+SwapSpace& SwapSpace::GetInstance()
+{
+    static SwapSpace swap;
+    return swap;
+}
+
+bool SwapSpace::Init(size_t slots)
+{
+    if (store_ || !slots || (slots > kMaxSlots))
+        return false;
+
+    void* run = PhysicalFrameAllocator::GetInstance().AllocFrames(slots);
+    if (!run)
+        return false;
+
+    store_      = static_cast<uint8_t*>(PhysToVirt(run));
+    slots_      = slots;
+    free_slots_ = slots;
+    return true;
+}
+
+int SwapSpace::AllocSlot()
+{
+    if (!free_slots_)
+        return -1;
+
+    /* Continue where the last search stopped, freed slots are found again
+       once the search wraps around. */
+    for (size_t i = 0; i < slots_; ++i) {
+        size_t slot = next_;
+        next_ = (next_ + 1 == slots_) ? 0 : (next_ + 1);
+        if (!refcounts_[slot]) {
+            refcounts_[slot] = 1;
+            free_slots_--;
+            return static_cast<int>(slot);
+        }
+    }
+    return -1;
+}
+
+bool SwapSpace::DupSlot(uint32_t slot)
+{
+    if ((slot >= slots_) || !refcounts_[slot] || (UINT8_MAX == refcounts_[slot]))
+        return false;
+
+    refcounts_[slot]++;
+    return true;
+}
+
+void SwapSpace::FreeSlot(uint32_t slot)
+{
+    if ((slot >= slots_) || !refcounts_[slot])
+        return;
+
+    if (!--refcounts_[slot])
+        free_slots_++;
+}
+
+void SwapSpace::WritePage(uint32_t slot, const void* page)
+{
+    memcpy(store_ + (slot * kPageSize), page, kPageSize);
+}
+
+void SwapSpace::ReadPage(uint32_t slot, void* page) const
+{
+    memcpy(page, store_ + (slot * kPageSize), kPageSize);
+}
+} // end vmem
+} // end cosmo
@@ -0,0 +1,965 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "Cpu.h"
+#include "FrameMagazine.h"
+#include "PhysicalFrameAllocator.h"
+#include "PhysMap.h"
+#include "ZeroedFramePool.h"
+#include "PageTableCache.h"
+#include "SwapSpace.h"
+#include "VirtualMemoryManager.h"
+
+namespace cosmo
+{
+namespace vmem
+{
+/* Page directory installed by loader.nasm. With PAE these are the four page
+   directories referenced by the boot PDPT. */
+extern "C" PageEntry BootPageDirectory[];
+
+static_assert(kPhysMapSize == PhysicalFrameAllocator::kNormalZoneEnd,
+              "the physmap must cover exactly the DMA and normal zones");
+
+/*!
+ * \brief Return \c true if the range [\a start, \a end) may not be remapped.
+ *
+ * The physmap and the recursive mapping are managed directly through their
+ * PDEs.
+ */
+static bool IsReserved(uint32_t start, uint32_t end)
+{
+    return ((start < (kPhysMapBase + kPhysMapSize)) && (end > kPhysMapBase)) ||
+           (end > VirtualMemoryManager::kPageTables);
+}
+
+/*!
+ * \brief Return \c true if the page at \a virt may not be remapped.
+ */
+static bool IsReserved(uint32_t virt)
+{
+    return IsReserved(virt, virt + 1);
+}
+
+void TlbBatch::Add(uint32_t addr)
+{
+    /* Track kernel pages even once the batch is full, a plain CR3 reload
+       leaves their global entries in place. */
+    if (addr >= kPhysMapBase)
+        kernel_ = true;
+
+    if (full_)
+        return;
+
+    if (kMaxPages == count_) {
+        full_ = true;
+        return;
+    }
+    pages_[count_++] = addr;
+}
+
+void TlbBatch::Flush()
+{
+    if (full_) {
+        if (kernel_)
+            cpu::FlushTlbGlobal();
+        else
+            cpu::FlushTlb();
+    } else {
+        for (size_t i = 0; i < count_; ++i)
+            cpu::Invlpg(pages_[i]);
+    }
+    count_  = 0;
+    full_   = false;
+    kernel_ = false;
+}
+
+VirtualMemoryManager& VirtualMemoryManager::GetInstance()
+{
+    static VirtualMemoryManager vmm;
+    return vmm;
+}
+
+void VirtualMemoryManager::Init(const KernelDescriptor& kernel_desc,
+                                size_t mem_size_kb)
+{
+    uint32_t pd_phys = reinterpret_cast<uintptr_t>(BootPageDirectory) -
+                       kernel_desc.kernel_virtual_base;
+
+    /* Point the last PDE back at the page directory. The directory then
+       doubles as the page table of the top 4 MiB, exposing every page
+       table (and the directory itself) in that window. With PAE the last
+       four PDEs point at the four directories and the window is 8 MiB. */
+    for (uint32_t i = 0; i < kDirectoryPages; ++i) {
+        BootPageDirectory[kRecursivePde + i] =
+            (pd_phys + (i * kPageSize)) | kPagePresent | kPageWritable;
+        kernel_space_.directory[i] = pd_phys + (i * kPageSize);
+    }
+    kernel_space_.root = cpu::ReadCr3();
+    cpu::FlushTlb();
+
+    /* Extend the boot mapping of the first 4 MiB to all RAM the physmap can
+       hold. The new PDEs were not present, so no TLB flush is needed. */
+    uint64_t ram = static_cast<uint64_t>(mem_size_kb) * 1024;
+    uint32_t end = (ram < kPhysMapSize) ? static_cast<uint32_t>(ram) :
+                                          kPhysMapSize;
+    for (uint32_t phys = 0; phys < end; phys += kLargePageSize) {
+        PageEntry* pde = Pde(kPhysMapBase + phys);
+        if (!(*pde & kPagePresent))
+            *pde = phys | kPageLarge | kPageWritable | kPagePresent;
+    }
+    physmap_end_ = end;
+
+    /* Without CR0.WP ring 0 writes ignore read-only page protection. */
+    cpu::WriteCr0(cpu::ReadCr0() | cpu::kCr0Wp);
+
+    /* Kernel translations are the same in every address space. Marking them
+       global keeps them in the TLB across CR3 reloads. The G bits are set
+       before CR4.PGE is turned on. The recursive PDE must stay non-global,
+       it differs per page directory. */
+    cpu::CpuidRegs regs = cpu::Cpuid(cpu::kCpuidFeatureLeaf);
+    if (regs.edx & cpu::kCpuidEdxPge) {
+        for (uint32_t phys = 0; phys < end; phys += kLargePageSize)
+            *Pde(kPhysMapBase + phys) |= kPageGlobal;
+        cpu::WriteCr4(cpu::ReadCr4() | cpu::kCr4Pge);
+        global_pages_ = true;
+    }
+}
+
+uint32_t VirtualMemoryManager::PageFlags(uint32_t virt, uint32_t flags) const
+{
+    flags = (flags & kFlagsMask) | kPagePresent;
+    if (global_pages_ && (virt >= kPhysMapBase) && !(flags & kPageUser))
+        flags |= kPageGlobal;
+    return flags;
+}
+
+PageEntry* VirtualMemoryManager::MappedPte(uint32_t virt)
+{
+    PageEntry pde = *Pde(virt);
+    if (!(pde & kPagePresent) || (pde & kPageLarge))
+        return nullptr;
+
+    PageEntry* pte = Pte(virt);
+    return (*pte & kPagePresent) ? pte : nullptr;
+}
+
+PageEntry* VirtualMemoryManager::DirectoryEntry(const AddressSpace& space,
+                                               uint32_t index)
+{
+    return static_cast<PageEntry*>(
+               PhysToVirt(space.directory[index / kEntriesPerTable])) +
+           (index % kEntriesPerTable);
+}
+
+void VirtualMemoryManager::WriteEntry(PageEntry* entry, PageEntry value)
+{
+#ifdef COSMO_PAE
+    volatile uint32_t* half = reinterpret_cast<volatile uint32_t*>(entry);
+    half[0] = 0;
+    half[1] = static_cast<uint32_t>(value >> 32);
+    half[0] = static_cast<uint32_t>(value);
+#else
+    *entry = value;
+#endif
+}
+
+bool VirtualMemoryManager::EnsurePageTables(uint32_t first, uint32_t last,
+                                            uint32_t flags, TlbBatch& tlb)
+{
+    PageEntry* pd      = reinterpret_cast<PageEntry*>(kPageDirectory);
+    size_t     missing = 0;
+    for (uint32_t i = first; i <= last; ++i) {
+        if (!(pd[i] & kPagePresent))
+            missing++;
+        else if (pd[i] & kPageLarge)
+            return false;
+    }
+
+    void* tables[kTableBatch];
+    if (missing && !PageTableCache::GetInstance().Alloc(tables, missing))
+        return false;
+
+    for (uint32_t i = first; i <= last; ++i) {
+        if (!(pd[i] & kPagePresent)) {
+            /* The table's window under kPageTables was not present before,
+               so there is no stale translation of it to invalidate. */
+            WriteEntry(&pd[i], reinterpret_cast<uintptr_t>(tables[--missing]) |
+                               kPagePresent | kPageWritable |
+                               (flags & kPageUser));
+            SyncKernelPde(i);
+        } else if ((flags & kPageUser) && !(pd[i] & kPageUser)) {
+            /* The PDE must be at least as permissive as the PTEs below
+               it. */
+            pd[i] |= kPageUser;
+            SyncKernelPde(i);
+            tlb.Add(i << kPdeShift);
+        }
+    }
+    return true;
+}
+
+void VirtualMemoryManager::SyncKernelPde(uint32_t index)
+{
+    if (index < kKernelPde)
+        return;
+
+    PageEntry pde = *(reinterpret_cast<PageEntry*>(kPageDirectory) + index);
+    for (AddressSpace* space = &kernel_space_; space; space = space->next) {
+        if (space != current_)
+            WriteEntry(DirectoryEntry(*space, index), pde);
+    }
+}
+
+bool VirtualMemoryManager::MapPage(uint32_t virt, PhysAddr phys,
+                                   uint32_t flags, TlbBatch& tlb)
+{
+    if (IsReserved(virt))
+        return false;
+
+    if (!EnsurePageTables(virt >> kPdeShift, virt >> kPdeShift, flags, tlb))
+        return false;
+
+    PageEntry* pte = Pte(virt);
+    bool       was_present = *pte & kPagePresent;
+    WriteEntry(pte, (phys & kFrameMask) | PageFlags(virt, flags));
+
+    /* Non-present entries are never cached, only replaced mappings need an
+       invalidation. */
+    if (was_present)
+        tlb.Add(virt);
+    return true;
+}
+
+bool VirtualMemoryManager::UnmapPage(uint32_t virt, TlbBatch& tlb)
+{
+    if (IsReserved(virt))
+        return false;
+
+    PageEntry* pte = MappedPte(virt);
+    if (!pte)
+        return false;
+
+    WriteEntry(pte, 0);
+    tlb.Add(virt);
+    return true;
+}
+
+bool VirtualMemoryManager::ProtectPage(uint32_t virt, uint32_t flags,
+                                       TlbBatch& tlb)
+{
+    if (IsReserved(virt))
+        return false;
+
+    PageEntry* pte = MappedPte(virt);
+    if (!pte)
+        return false;
+
+    if ((flags & kPageUser) && !(*Pde(virt) & kPageUser)) {
+        *Pde(virt) |= kPageUser;
+        SyncKernelPde(virt >> kPdeShift);
+    }
+
+    WriteEntry(pte, (*pte & kFrameMask) | PageFlags(virt, flags));
+    tlb.Add(virt);
+    return true;
+}
+
+bool VirtualMemoryManager::Map(uint32_t virt, PhysAddr phys, uint32_t flags)
+{
+    cpu::InterruptGuard guard;
+    TlbBatch            tlb;
+    return MapPage(virt, phys, flags, tlb);
+}
+
+bool VirtualMemoryManager::MapRange(uint32_t virt, PhysAddr phys,
+                                    size_t count, uint32_t flags)
+{
+    virt &= kPageMask;
+    if (!count || (virt >= kPageTables) ||
+        (count > ((kPageTables - virt) / kPageSize)))
+        return false;
+    uint32_t end = virt + (count * kPageSize);
+    if (IsReserved(virt, end))
+        return false;
+
+    /* The range lies entirely below or entirely above the physmap, so one
+       set of PTE flags fits every page. */
+    PageEntry entry = (phys & kFrameMask) | PageFlags(virt, flags);
+
+    cpu::InterruptGuard guard;
+    TlbBatch            tlb;
+
+    uint32_t last = (end - 1) >> kPdeShift;
+    uint32_t page = virt;
+    while (page < end) {
+        uint32_t first      = page >> kPdeShift;
+        uint32_t step_last  = ((last - first) < kTableBatch) ?
+                              last : (first + kTableBatch - 1);
+        uint32_t step_end   = (step_last == last) ? end :
+                              ((step_last + 1) << kPdeShift);
+
+        if (!EnsurePageTables(first, step_last, flags, tlb)) {
+            /* Roll back the pages mapped so far. */
+            for (uint32_t undo = virt; undo < page; undo += kPageSize)
+                UnmapPage(undo, tlb);
+            return false;
+        }
+
+        /* Through the recursive mapping the PTEs of consecutive tables are
+           one array, fill them with a plain store loop. Only replaced
+           mappings need an invalidation. */
+        PageEntry* pte = Pte(page);
+        size_t     n   = (step_end - page) / kPageSize;
+        for (size_t i = 0; i < n; ++i, entry += kPageSize) {
+            if (pte[i] & kPagePresent)
+                tlb.Add(page + (i * kPageSize));
+            WriteEntry(&pte[i], entry);
+        }
+        page = step_end;
+    }
+    return true;
+}
+
+void* VirtualMemoryManager::MapIo(PhysAddr phys, size_t size)
+{
+    uint32_t offset = static_cast<uint32_t>(phys) & ~kPageMask;
+    if (!size || (size > kIoWindowSize))
+        return nullptr;
+
+    cpu::InterruptGuard guard;
+
+    size_t count = (offset + size + kPageSize - 1) / kPageSize;
+    if (count > ((kIoWindowBase + kIoWindowSize - io_next_) / kPageSize))
+        return nullptr;
+
+    if (!MapRange(io_next_, phys - offset, count,
+                  kPageWritable | kPageWriteThrough | kPageCacheDisable))
+        return nullptr;
+
+    uint32_t virt = io_next_;
+    io_next_ += count * kPageSize;
+    return reinterpret_cast<void*>(virt + offset);
+}
+
+void VirtualMemoryManager::UnmapIo(const void* virt, size_t size)
+{
+    uint32_t addr = reinterpret_cast<uintptr_t>(virt);
+    uint32_t base = addr & kPageMask;
+    if (!size || (size > kIoWindowSize) || (addr < kIoWindowBase))
+        return;
+
+    cpu::InterruptGuard guard;
+
+    size_t count = ((addr - base) + size + kPageSize - 1) / kPageSize;
+    if ((base >= io_next_) || (count > ((io_next_ - base) / kPageSize)))
+        return;
+
+    UnmapRange(base, count);
+    if ((base + (count * kPageSize)) == io_next_)
+        io_next_ = base;
+}
+
+bool VirtualMemoryManager::Unmap(uint32_t virt)
+{
+    cpu::InterruptGuard guard;
+    TlbBatch            tlb;
+    return UnmapPage(virt, tlb);
+}
+
+void VirtualMemoryManager::UnmapRange(uint32_t virt, size_t count)
+{
+    cpu::InterruptGuard guard;
+    TlbBatch            tlb;
+
+    for (size_t i = 0; i < count; ++i)
+        UnmapPage(virt + (i * kPageSize), tlb);
+}
+
+bool VirtualMemoryManager::Protect(uint32_t virt, uint32_t flags)
+{
+    cpu::InterruptGuard guard;
+    TlbBatch            tlb;
+    return ProtectPage(virt, flags, tlb);
+}
+
+bool VirtualMemoryManager::ProtectRange(uint32_t virt, size_t count,
+                                        uint32_t flags)
+{
+    cpu::InterruptGuard guard;
+    TlbBatch            tlb;
+    bool                all_mapped = true;
+
+    for (size_t i = 0; i < count; ++i) {
+        if (!ProtectPage(virt + (i * kPageSize), flags, tlb))
+            all_mapped = false;
+    }
+    return all_mapped;
+}
+
+bool VirtualMemoryManager::Translate(uint32_t virt, PhysAddr* phys) const
+{
+    PageEntry pde = *Pde(virt);
+    if (!(pde & kPagePresent))
+        return false;
+
+    if (pde & kPageLarge) {
+        *phys = (pde & kFrameMask & ~static_cast<PageEntry>(kLargePageSize - 1)) |
+                (virt & (kLargePageSize - 1));
+        return true;
+    }
+
+    PageEntry pte = *Pte(virt);
+    if (!(pte & kPagePresent))
+        return false;
+
+    *phys = (pte & kFrameMask) | (virt & kFlagsMask);
+    return true;
+}
+
+VirtualMemoryManager::Region* VirtualMemoryManager::FindRegion(uint32_t virt)
+{
+    /* Faults tend to come in runs over the same region, try the last hit
+       before scanning the table. */
+    Region* region = &regions_[last_region_];
+    if ((virt >= region->start) && (virt < region->end))
+        return region;
+
+    for (size_t i = 0; i < kMaxRegions; ++i) {
+        region = &regions_[i];
+        if ((virt >= region->start) && (virt < region->end)) {
+            last_region_ = i;
+            return region;
+        }
+    }
+    return nullptr;
+}
+
+bool VirtualMemoryManager::Reserve(uint32_t virt, size_t count, uint32_t flags)
+{
+    uint32_t start = virt & kPageMask;
+    if (!count || (start >= kPageTables) ||
+        (count > ((kPageTables - start) / kPageSize)))
+        return false;
+    uint32_t end = start + (count * kPageSize);
+    if (IsReserved(start, end))
+        return false;
+
+    cpu::InterruptGuard guard;
+
+    Region* free_slot = nullptr;
+    for (Region& region : regions_) {
+        if (!region.end) {
+            if (!free_slot)
+                free_slot = &region;
+        } else if ((start < region.end) && (region.start < end)) {
+            return false;
+        }
+    }
+    if (!free_slot)
+        return false;
+
+    free_slot->start = start;
+    free_slot->end   = end;
+    free_slot->flags = (flags & kFlagsMask) | kPagePresent;
+    return true;
+}
+
+bool VirtualMemoryManager::Release(uint32_t virt)
+{
+    cpu::InterruptGuard guard;
+
+    Region* region = FindRegion(virt);
+    if (!region || (region->start != (virt & kPageMask)))
+        return false;
+
+    PageMagazine& magazine = PageMagazine::GetInstance();
+    SwapSpace&    swap     = SwapSpace::GetInstance();
+    TlbBatch      tlb;
+    for (uint32_t page = region->start; page < region->end; page += kPageSize) {
+        PageEntry* pde = Pde(page);
+        if (!(*pde & kPagePresent)) {
+            /* Skip the rest of the page table's span in one step. */
+            page = (page | (kLargePageSize - kPageSize));
+            continue;
+        }
+
+        PageEntry* pte = Pte(page);
+        if (*pte & kPageSwapped) {
+            swap.FreeSlot(static_cast<uint32_t>(*pte >> 12));
+            WriteEntry(pte, 0);
+            continue;
+        }
+        if (!(*pte & kPagePresent))
+            continue;
+
+        PhysAddr frame = *pte & kFrameMask;
+        UnmapPage(page, tlb);
+        magazine.PutFrame(frame);
+    }
+
+    region->start = 0;
+    region->end   = 0;
+    region->flags = 0;
+    return true;
+}
+
+bool VirtualMemoryManager::HandlePageFault(uint32_t fault_addr,
+                                           uint32_t err_code)
+{
+    uint64_t start = cpu::ReadTsc();
+
+    /* Protection and reserved bit faults hit an existing mapping. Demand
+       paging only fills in pages that are not present, the only protection
+       fault resolved here is a write to a copy-on-write page. */
+    if (err_code & kFaultReservedBit) {
+        fault_stats_.rejected++;
+        return false;
+    }
+    if (err_code & kFaultProtection) {
+        if (!(err_code & kFaultWrite) ||
+            !ResolveCopyOnWrite(fault_addr & kPageMask, err_code)) {
+            fault_stats_.rejected++;
+            return false;
+        }
+        CountResolved(start);
+        return true;
+    }
+
+    Region* region = FindRegion(fault_addr);
+    if (!region ||
+        ((err_code & kFaultWrite) && !(region->flags & kPageWritable)) ||
+        ((err_code & kFaultUser) && !(region->flags & kPageUser))) {
+        fault_stats_.rejected++;
+        return false;
+    }
+
+    PhysicalFrameAllocator& falloc   = PhysicalFrameAllocator::GetInstance();
+    PageMagazine&           magazine = PageMagazine::GetInstance();
+    uint32_t                page     = fault_addr & kPageMask;
+    uint32_t                flags    = region->flags;
+    PageEntry*              pte      = (*Pde(page) & kPagePresent) ? Pte(page) :
+                                                                     nullptr;
+    bool                    swapped  = pte && (*pte & kPageSwapped);
+    PhysAddr                frame    = 0;
+    bool                    fill     = false;
+
+#ifdef COSMO_PAE
+    /* Frames above 4 GiB can only be reached through page mappings, so
+       demand paging uses them first. They lie outside the physmap and are
+       filled through the new mapping. */
+    if (falloc.GetZoneFreeFrames(PhysicalFrameAllocator::Zone::kPae)) {
+        frame = falloc.AllocPhysFrame(PhysicalFrameAllocator::Zone::kPae);
+        fill  = (0 != frame);
+    }
+#endif
+
+    /* The pool usually has a frame zeroed by the idle loop, which keeps the
+       clearing of the page off the fault path. A page coming back from swap
+       is overwritten anyway and takes the hottest frame of the magazine. */
+    if (!frame) {
+        frame = reinterpret_cast<uintptr_t>(
+            swapped ? magazine.AllocFrame() :
+                      ZeroedFramePool::GetInstance().AllocZeroedFrame());
+        fill  = swapped;
+    }
+    if (!frame && ScanClock(2 * kScanBatch, 1)) {
+        /* Background reclaim fell behind, evict a page right here. The
+           freed frame may lie in any zone. */
+        reclaim_stats_.direct++;
+        frame = falloc.AllocPhysFrame();
+        fill  = (0 != frame);
+    }
+    if (!frame) {
+        fault_stats_.no_memory++;
+        fault_stats_.rejected++;
+        return false;
+    }
+
+    falloc.GetDescriptor(frame)->owner =
+        (flags & kPageUser) ? kFrameOwnerUser : kFrameOwnerKernel;
+
+    uint32_t slot = swapped ? static_cast<uint32_t>(*pte >> 12) : 0;
+    TlbBatch tlb;
+    if (!MapPage(page, frame, fill ? (flags | kPageWritable) : flags, tlb)) {
+        magazine.PutFrame(frame);
+        fault_stats_.rejected++;
+        return false;
+    }
+
+    SwapSpace& swap = SwapSpace::GetInstance();
+    if (fill) {
+        if (swapped)
+            swap.ReadPage(slot, reinterpret_cast<void*>(page));
+        else
+            memset(reinterpret_cast<void*>(page), 0, kPageSize);
+        if (!(flags & kPageWritable))
+            ProtectPage(page, flags, tlb);
+    }
+    if (swapped) {
+        swap.FreeSlot(slot);
+        reclaim_stats_.swapped_in++;
+    }
+
+    CountResolved(start);
+    return true;
+}
+
+bool VirtualMemoryManager::ResolveCopyOnWrite(uint32_t page, uint32_t err_code)
+{
+    PageEntry* pte = MappedPte(page);
+    if (!pte || !(*pte & kPageCopyOnWrite) ||
+        ((err_code & kFaultUser) && !(*pte & kPageUser)))
+        return false;
+
+    /* Only frames with a reference count are ever shared copy-on-write. */
+    PhysicalFrameAllocator& falloc = PhysicalFrameAllocator::GetInstance();
+    PhysAddr                frame  = *pte & kFrameMask;
+    FrameDescriptor*        desc   = falloc.GetDescriptor(frame);
+    if (!desc || !desc->refcount)
+        return false;
+
+    uint32_t flags = (static_cast<uint32_t>(*pte) & kFlagsMask &
+                      ~(kPageCopyOnWrite | kPageAccessed | kPageDirty)) |
+                     kPageWritable;
+    TlbBatch tlb;
+
+    if (1 == desc->refcount) {
+        /* Every other address space has dropped the page, the frame is
+           taken over without copying. */
+        desc->flags &= ~kFrameCopyOnWrite;
+        ProtectPage(page, flags, tlb);
+        fault_stats_.cow_reused++;
+        return true;
+    }
+
+    /* The copy lands in the physmap, the original is read through its
+       current mapping, which also works for frames above the physmap. */
+    PageMagazine& magazine = PageMagazine::GetInstance();
+    void*         copy     = magazine.AllocFrame();
+    if (!copy) {
+        fault_stats_.no_memory++;
+        return false;
+    }
+    memcpy(PhysToVirt(copy), reinterpret_cast<const void*>(page), kPageSize);
+    falloc.GetDescriptor(copy)->owner = desc->owner;
+
+    MapPage(page, reinterpret_cast<uintptr_t>(copy), flags, tlb);
+    magazine.PutFrame(frame);
+    fault_stats_.cow_copied++;
+    return true;
+}
+
+size_t VirtualMemoryManager::FreeFrames()
+{
+    /* Frames cached by the magazine count as used by the allocator but are
+       one pop away from the next fault. */
+    const PhysicalFrameAllocator& falloc = PhysicalFrameAllocator::GetInstance();
+    return falloc.GetMaxFrames() - falloc.GetUsedFrames() +
+           PageMagazine::GetInstance().GetCount();
+}
+
+void VirtualMemoryManager::SetReclaimWatermarks(size_t low, size_t high)
+{
+    cpu::InterruptGuard guard;
+
+    reclaim_low_  = low;
+    reclaim_high_ = (high < low) ? low : high;
+    reclaiming_   = false;
+}
+
+size_t VirtualMemoryManager::Reclaim()
+{
+    cpu::InterruptGuard guard;
+
+    /* Start below the low watermark and stop at the high one, so reclaim
+       runs in bursts instead of evicting a page per idle iteration. */
+    size_t free_frames = FreeFrames();
+    if (!reclaiming_) {
+        if (free_frames >= reclaim_low_)
+            return 0;
+        reclaiming_ = true;
+    }
+    if (free_frames >= reclaim_high_) {
+        reclaiming_ = false;
+        return 0;
+    }
+    return ScanClock(kScanBatch, reclaim_high_ - free_frames);
+}
+
+bool VirtualMemoryManager::AdvanceClock()
+{
+    /* Check the region under the hand, then every slot once more. */
+    for (size_t i = 0; i <= kMaxRegions; ++i) {
+        const Region& region = regions_[clock_region_];
+        if (region.end && (clock_page_ < region.end)) {
+            if (clock_page_ < region.start)
+                clock_page_ = region.start;
+            return true;
+        }
+        clock_region_ = (clock_region_ + 1) % kMaxRegions;
+        clock_page_   = 0;
+    }
+    return false;
+}
+
+size_t VirtualMemoryManager::ScanClock(size_t max_scan, size_t target)
+{
+    PhysicalFrameAllocator& falloc  = PhysicalFrameAllocator::GetInstance();
+    SwapSpace&              swap    = SwapSpace::GetInstance();
+    TlbBatch                tlb;
+    size_t                  evicted = 0;
+
+    for (size_t scanned = 0; (scanned < max_scan) && (evicted < target) &&
+                             swap.GetFreeSlots(); ++scanned) {
+        if (!AdvanceClock())
+            break;
+
+        uint32_t page = clock_page_;
+        clock_page_ += kPageSize;
+        reclaim_stats_.scanned++;
+
+        if (!(*Pde(page) & kPagePresent)) {
+            /* Skip the rest of the page table's span in one step. */
+            clock_page_ = (page | (kLargePageSize - kPageSize)) + kPageSize;
+            continue;
+        }
+
+        PageEntry* pte = MappedPte(page);
+        if (!pte)
+            continue;
+
+        PageEntry entry = *pte;
+        if (entry & kPageAccessed) {
+            /* Used since the last sweep, give it a second chance. The TLB
+               entry goes too, or the next access would not set the bit
+               again. */
+            WriteEntry(pte, entry & ~static_cast<PageEntry>(kPageAccessed));
+            tlb.Add(page);
+            continue;
+        }
+
+        /* Only unshared frames are evicted, the other mappings of a shared
+           one are not known here. */
+        PhysAddr         frame = entry & kFrameMask;
+        FrameDescriptor* desc  = falloc.GetDescriptor(frame);
+        if (!desc || (1 != desc->refcount))
+            continue;
+
+        int slot = swap.AllocSlot();
+        if (-1 == slot)
+            break;
+
+        /* Interrupts are off, nothing touches the page between the copy and
+           the TLB flush at the end of the scan. */
+        swap.WritePage(slot, reinterpret_cast<const void*>(page));
+        WriteEntry(pte, (static_cast<PageEntry>(slot) << 12) | kPageSwapped);
+        tlb.Add(page);
+        falloc.PutFrame(frame);
+        evicted++;
+    }
+
+    reclaim_stats_.evicted += evicted;
+    return evicted;
+}
+
+void VirtualMemoryManager::CountResolved(uint64_t start)
+{
+    uint64_t cycles64 = cpu::ReadTsc() - start;
+    uint32_t cycles   = (cycles64 > UINT32_MAX) ? UINT32_MAX :
+                                                   static_cast<uint32_t>(cycles64);
+    fault_stats_.resolved++;
+    fault_stats_.total_cycles += cycles64;
+    if (cycles < fault_stats_.min_cycles)
+        fault_stats_.min_cycles = cycles;
+    if (cycles > fault_stats_.max_cycles)
+        fault_stats_.max_cycles = cycles;
+}
+
+bool VirtualMemoryManager::CloneTable(uint32_t index, PageEntry* table,
+                                      TlbBatch& tlb)
+{
+    PhysicalFrameAllocator& falloc = PhysicalFrameAllocator::GetInstance();
+    SwapSpace&              swap   = SwapSpace::GetInstance();
+    PageEntry*              parent = Pte(index << kPdeShift);
+
+    for (uint32_t i = 0; i < kEntriesPerTable; ++i) {
+        PageEntry pte = parent[i];
+        if (pte & kPageSwapped) {
+            /* Both copies read the slot back on their own. */
+            if (!swap.DupSlot(static_cast<uint32_t>(pte >> 12)))
+                return false;
+            table[i] = pte;
+            continue;
+        }
+        if (!(pte & kPagePresent))
+            continue;
+
+        /* Frames without a reference count (MMIO, reserved memory) are
+           simply shared. */
+        PhysAddr         frame = pte & kFrameMask;
+        FrameDescriptor* desc  = falloc.GetDescriptor(frame);
+        if (desc && desc->refcount) {
+            if (!falloc.GetFrame(frame))
+                return false;
+
+            if (pte & kPageWritable) {
+                pte = (pte & ~static_cast<PageEntry>(kPageWritable)) |
+                      kPageCopyOnWrite;
+                WriteEntry(&parent[i], pte);
+                tlb.Add((index << kPdeShift) + (i * kPageSize));
+            }
+            if (pte & kPageCopyOnWrite)
+                desc->flags |= kFrameCopyOnWrite;
+        }
+        table[i] = pte;
+    }
+    return true;
+}
+
+void VirtualMemoryManager::FreeAddressSpace(const AddressSpace& space)
+{
+    PhysicalFrameAllocator& falloc   = PhysicalFrameAllocator::GetInstance();
+    PageMagazine&           magazine = PageMagazine::GetInstance();
+    SwapSpace&              swap     = SwapSpace::GetInstance();
+
+    for (uint32_t i = 0; i < kKernelPde; ++i) {
+        PageEntry pde = *DirectoryEntry(space, i);
+        if (!(pde & kPagePresent) || (pde & kPageLarge))
+            continue;
+
+        PhysAddr         table_phys = pde & kFrameMask;
+        const PageEntry* table      = static_cast<const PageEntry*>(
+            PhysToVirt(static_cast<uint32_t>(table_phys)));
+        for (uint32_t k = 0; k < kEntriesPerTable; ++k) {
+            if (table[k] & kPagePresent)
+                magazine.PutFrame(table[k] & kFrameMask);
+            else if (table[k] & kPageSwapped)
+                swap.FreeSlot(static_cast<uint32_t>(table[k] >> 12));
+        }
+        falloc.FreeFrame(table_phys);
+    }
+
+    for (uint32_t i = 0; i < kDirectoryPages; ++i)
+        falloc.FreeFrame(static_cast<PhysAddr>(space.directory[i]));
+#ifdef COSMO_PAE
+    falloc.FreeFrame(static_cast<PhysAddr>(space.root));
+#endif
+}
+
+bool VirtualMemoryManager::CloneAddressSpace(AddressSpace* child)
+{
+    cpu::InterruptGuard guard;
+
+    PageTableCache& cache = PageTableCache::GetInstance();
+    PageEntry*      pd    = reinterpret_cast<PageEntry*>(kPageDirectory);
+
+    /* The directories, and with PAE the PDPT, come zeroed from the
+       cache. */
+#ifdef COSMO_PAE
+    void* roots[kDirectoryPages + 1];
+#else
+    void* roots[kDirectoryPages];
+#endif
+    if (!cache.Alloc(roots, sizeof(roots) / sizeof(roots[0])))
+        return false;
+    for (uint32_t i = 0; i < kDirectoryPages; ++i)
+        child->directory[i] = reinterpret_cast<uintptr_t>(roots[i]);
+#ifdef COSMO_PAE
+    child->root     = reinterpret_cast<uintptr_t>(roots[kDirectoryPages]);
+    PageEntry* pdpt = static_cast<PageEntry*>(PhysToVirt(child->root));
+    for (uint32_t i = 0; i < kDirectoryPages; ++i)
+        pdpt[i] = child->directory[i] | kPagePresent;
+#else
+    child->root = child->directory[0];
+#endif
+
+    /* Take all user half page tables before the current address space is
+       touched. They are parked in the new PDEs, so on failure
+       FreeAddressSpace() finds them there. */
+    size_t tables_left = 0;
+    for (uint32_t i = 0; i < kKernelPde; ++i) {
+        if ((pd[i] & kPagePresent) && !(pd[i] & kPageLarge))
+            tables_left++;
+    }
+
+    void*  tables[kTableBatch];
+    size_t batch = 0;
+    for (uint32_t i = 0; i < kKernelPde; ++i) {
+        if (!(pd[i] & kPagePresent) || (pd[i] & kPageLarge))
+            continue;
+
+        if (!batch) {
+            batch = (tables_left < kTableBatch) ? tables_left : kTableBatch;
+            if (!cache.Alloc(tables, batch)) {
+                FreeAddressSpace(*child);
+                return false;
+            }
+            tables_left -= batch;
+        }
+        *DirectoryEntry(*child, i) =
+            reinterpret_cast<uintptr_t>(tables[--batch]) |
+            (pd[i] & (kPagePresent | kPageWritable | kPageUser));
+    }
+
+    /* Copy the PTEs. Write protecting the current address space only
+       lowers permissions, so a failure half way leaves it intact: the
+       next write fault on a page finds it unshared and takes it over. */
+    TlbBatch tlb;
+    for (uint32_t i = 0; i < kKernelPde; ++i) {
+        PageEntry pde = *DirectoryEntry(*child, i);
+        if (!(pde & kPagePresent))
+            continue;
+
+        PageEntry* table = static_cast<PageEntry*>(
+            PhysToVirt(static_cast<uint32_t>(pde & kFrameMask)));
+        if (!CloneTable(i, table, tlb)) {
+            FreeAddressSpace(*child);
+            return false;
+        }
+    }
+
+    for (uint32_t i = kKernelPde; i < kRecursivePde; ++i)
+        *DirectoryEntry(*child, i) = pd[i];
+    for (uint32_t i = 0; i < kDirectoryPages; ++i) {
+        *DirectoryEntry(*child, kRecursivePde + i) =
+            child->directory[i] | kPagePresent | kPageWritable;
+    }
+
+    child->next        = kernel_space_.next;
+    kernel_space_.next = child;
+    return true;
+}
+
+void VirtualMemoryManager::SwitchAddressSpace(AddressSpace* space)
+{
+    cpu::InterruptGuard guard;
+
+    if (space == current_)
+        return;
+
+    /* Global kernel translations survive the reload. */
+    current_ = space;
+    cpu::WriteCr3(space->root);
+}
+
+bool VirtualMemoryManager::DestroyAddressSpace(AddressSpace* space)
+{
+    cpu::InterruptGuard guard;
+
+    if ((space == current_) || (space == &kernel_space_))
+        return false;
+
+    AddressSpace* prev = &kernel_space_;
+    while (prev->next && (prev->next != space))
+        prev = prev->next;
+    if (!prev->next)
+        return false;
+    prev->next = space->next;
+
+    FreeAddressSpace(*space);
+    return true;
+}
+} // end vmem
+} // end cosmo
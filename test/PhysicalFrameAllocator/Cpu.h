@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace cosmo
+{
+/*!
+ * \namespace cpu
+ * \brief Host stand-in for the kernel's Cpu module.
+ *
+ * The harness runs in user space, where cli and sti fault. Code built into
+ * the harness, e.g. FrameMagazine, only needs the interrupt guard, which
+ * does nothing here.
+ */
+namespace cpu
+{
+/*!
+ * \class InterruptGuard
+ * \brief No-op replacement of the kernel's interrupt guard.
+ */
+class InterruptGuard
+{
+public:
+    InterruptGuard() { }
+    ~InterruptGuard() { }
+
+    /* Disable copy construction and copy assignment. */
+    InterruptGuard(const InterruptGuard&) = delete;
+    InterruptGuard& operator=(const InterruptGuard&) = delete;
+
+    /* Disable move construction and move assignment. */
+    InterruptGuard(InterruptGuard&&) = delete;
+    InterruptGuard& operator=(InterruptGuard&&) = delete;
+}; // end InterruptGuard
+} // end cpu
+} // end cosmo
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include <vector>
+
+#include "multiboot.h"
+#include "PhysicalFrameAllocator.h"
+
+namespace cosmo
+{
+/*!
+ * \namespace test
+ * \brief Host side test and benchmark support.
+ */
+namespace test
+{
+/*!
+ * \struct MemoryRegion
+ * \brief A single entry of a synthetic Multiboot memory map.
+ */
+struct MemoryRegion
+{
+    uint64_t addr; /*!< Physical start address. */
+    uint64_t len;  /*!< Length in bytes. */
+    uint32_t type; /*!< MULTIBOOT_MEMORY_* region type. */
+}; // end MemoryRegion
+
+/*!
+ * \struct BootModule
+ * \brief A synthetic Multiboot module.
+ */
+struct BootModule
+{
+    uint32_t    start;   /*!< Physical start address. */
+    uint32_t    end;     /*!< Physical end address. */
+    const char* cmdline; /*!< Command line or nullptr. */
+}; // end BootModule
+
+/*!
+ * \class HostMachine
+ * \brief Boot the PhysicalFrameAllocator on a synthetic machine.
+ *
+ * The allocator stores 32-bit virtual addresses, so on a 64-bit host its
+ * metadata must live below 4 GiB. HostMachine maps an arena with
+ * MAP_32BIT and picks a kernel virtual base such that the physical address
+ * right after the fake kernel image lands at the start of the arena. The
+ * synthetic Multiboot memory map and module list are placed at the end of
+ * the arena.
+ */
+class HostMachine
+{
+public:
+    static const uint32_t kKernelStart = 0x00100000; /*!< Fake kernel physical start. */
+    static const uint32_t kKernelEnd   = 0x00200000; /*!< Fake kernel physical end. */
+    static const size_t   kArenaSize   = 8 << 20;    /*!< Allocator metadata arena. */
+    static const size_t   kMapOffset   = 7 << 20;    /*!< Memory map offset in the arena. */
+    static const size_t   kModsOffset  = kMapOffset + (512 << 10); /*!< Module list offset. */
+
+    HostMachine() :
+        arena_(nullptr)
+    {
+        void* arena = mmap(nullptr, kArenaSize, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+        if ((MAP_FAILED == arena) ||
+            (reinterpret_cast<uintptr_t>(arena) < kKernelEnd)) {
+            fprintf(stderr, "error, unable to map a 32-bit arena\n");
+            exit(EXIT_FAILURE);
+        }
+        arena_ = static_cast<uint8_t*>(arena);
+    }
+
+    ~HostMachine()
+    {
+        munmap(arena_, kArenaSize);
+    }
+
+    /* Disable copy construction and copy assignment. */
+    HostMachine(const HostMachine&) = delete;
+    HostMachine& operator=(const HostMachine&) = delete;
+
+    /* Disable move construction and move assignment. */
+    HostMachine(HostMachine&&) = delete;
+    HostMachine& operator=(HostMachine&&) = delete;
+
+    /*!
+     * \brief Return a PC style memory map with \a mem_kb KB of RAM.
+     *
+     * The map has 636 KB of conventional memory, the legacy video/BIOS hole
+     * and all remaining memory available from 1 MiB up.
+     */
+    static std::vector<MemoryRegion> PcMemoryMap(size_t mem_kb)
+    {
+        std::vector<MemoryRegion> map;
+        map.push_back({0x00000000, 0x0009F000, MULTIBOOT_MEMORY_AVAILABLE});
+        map.push_back({0x0009F000, 0x00061000, MULTIBOOT_MEMORY_RESERVED});
+        map.push_back({0x00100000,
+                       (static_cast<uint64_t>(mem_kb) * 1024) - 0x00100000,
+                       MULTIBOOT_MEMORY_AVAILABLE});
+        return map;
+    }
+
+    /*!
+     * \brief Initialize the PhysicalFrameAllocator singleton.
+     *
+     * \param map Memory map handed to the allocator.
+     * \param mem_kb Size of physical memory in KB.
+     * \param modules Boot modules. The module list and command lines are
+     *                placed at #kModsOffset in the arena.
+     */
+    vmem::PhysicalFrameAllocator& Boot(const std::vector<MemoryRegion>& map,
+                                       size_t mem_kb,
+                                       const std::vector<BootModule>& modules = {})
+    {
+        uint32_t virtual_base = VirtualBase();
+
+        multiboot_memory_map_t* mmap =
+            reinterpret_cast<multiboot_memory_map_t*>(arena_ + kMapOffset);
+        for (size_t i = 0; i < map.size(); ++i) {
+            memset(&mmap[i], 0, sizeof(mmap[i]));
+            mmap[i].size     = sizeof(mmap[i]) - sizeof(mmap[i].size);
+            mmap[i].addr_low  = static_cast<uint32_t>(map[i].addr);
+            mmap[i].addr_high = static_cast<uint32_t>(map[i].addr >> 32);
+            mmap[i].len_low   = static_cast<uint32_t>(map[i].len);
+            mmap[i].len_high  = static_cast<uint32_t>(map[i].len >> 32);
+            mmap[i].type     = map[i].type;
+        }
+
+        memset(&info_, 0, sizeof(info_));
+        info_.flags       = MULTIBOOT_INFO_MEMORY | MULTIBOOT_INFO_MEM_MAP;
+        info_.mem_lower   = 636;
+        info_.mem_upper   = mem_kb - 1024;
+        info_.mmap_addr   = kKernelEnd + kMapOffset;
+        info_.mmap_length = map.size() * sizeof(multiboot_memory_map_t);
+
+        if (!modules.empty()) {
+            multiboot_module_t* mods =
+                reinterpret_cast<multiboot_module_t*>(arena_ + kModsOffset);
+            size_t cmdline = kModsOffset + (modules.size() * sizeof(*mods));
+            for (size_t i = 0; i < modules.size(); ++i) {
+                memset(&mods[i], 0, sizeof(mods[i]));
+                mods[i].mod_start = modules[i].start;
+                mods[i].mod_end   = modules[i].end;
+                if (modules[i].cmdline) {
+                    strcpy(reinterpret_cast<char*>(arena_ + cmdline),
+                           modules[i].cmdline);
+                    mods[i].cmdline = kKernelEnd + cmdline;
+                    cmdline += strlen(modules[i].cmdline) + 1;
+                }
+            }
+            info_.flags      |= MULTIBOOT_INFO_MODS;
+            info_.mods_count  = modules.size();
+            info_.mods_addr   = kKernelEnd + kModsOffset;
+        }
+
+        vmem::KernelDescriptor desc = {
+            .kernel_physical_start = kKernelStart,
+            .kernel_physical_end   = kKernelEnd,
+            .kernel_virtual_start  = kKernelStart + virtual_base,
+            .kernel_virtual_end    = kKernelEnd + virtual_base,
+            .kernel_virtual_base   = virtual_base
+        };
+
+        auto& falloc = vmem::PhysicalFrameAllocator::GetInstance();
+        falloc.Init(&info_, kKernelEnd, mem_kb, desc);
+        return falloc;
+    }
+
+    /*!
+     * \brief Return the memory size the allocator derives from the map
+     *        passed to the last Boot().
+     */
+    size_t GetMemorySize() const
+    {
+        return vmem::PhysicalFrameAllocator::GetMemorySize(&info_,
+                                                           VirtualBase());
+    }
+
+private:
+    /*!
+     * \brief Return the virtual base that maps the fake kernel end to the
+     *        arena.
+     */
+    uint32_t VirtualBase() const
+    {
+        return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(arena_)) -
+               kKernelEnd;
+    }
+
+    uint8_t*         arena_; /*!< MAP_32BIT metadata arena. */
+    multiboot_info_t info_;  /*!< Multiboot info passed to Init(). */
+}; // end HostMachine
+} // end test
+} // end cosmo
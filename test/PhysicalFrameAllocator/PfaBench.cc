@@ -0,0 +1,246 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "FrameMagazine.h"
+#include "HostMachine.h"
+#include "PhysicalFrameAllocator.h"
+
+/*
+ * Microbenchmarks of the PhysicalFrameAllocator running on the host:
+ *   (1) Init() time as a function of RAM size.
+ *   (2) Alloc/free throughput of the single frame, batch and contiguous APIs.
+ *   (3) Time to find a free frame as memory fills up.
+ *   (4) PageMagazine vs. direct allocation, with and without touching the
+ *       frames.
+ * Results are in host nanoseconds. They are only meaningful relative to one
+ * another (e.g. before and after a change, or bitmap vs. buddy backend).
+ */
+
+using cosmo::test::HostMachine;
+using cosmo::vmem::PageMagazine;
+using cosmo::vmem::PhysicalFrameAllocator;
+
+using Zone   = PhysicalFrameAllocator::Zone;
+using Policy = PhysicalFrameAllocator::AllocPolicy;
+using Clock  = std::chrono::steady_clock;
+
+#ifdef COSMO_PFA_BUDDY
+static const char* kBackend = "buddy";
+#else
+static const char* kBackend = "bitmap";
+#endif
+
+static double ElapsedNs(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+static const char* PolicyName(Policy policy)
+{
+    return (Policy::kFirstFit == policy) ? "first fit" : "next fit";
+}
+
+static void BenchInit(HostMachine& machine)
+{
+    static const size_t kSizesMb[] = { 16, 64, 256, 1024, 3072 };
+    static const int    kReps      = 20;
+
+    printf("\nInit() time vs. RAM size\n");
+    printf("%10s %12s\n", "RAM (MiB)", "Init (us)");
+    for (size_t mb : kSizesMb) {
+        auto map = HostMachine::PcMemoryMap(mb * 1024);
+        machine.Boot(map, mb * 1024);
+
+        auto start = Clock::now();
+        for (int i = 0; i < kReps; ++i)
+            machine.Boot(map, mb * 1024);
+        printf("%10zu %12.1f\n", mb, ElapsedNs(start) / kReps / 1000.0);
+    }
+}
+
+static void BenchThroughput(HostMachine& machine, size_t mb, Policy policy)
+{
+    static const size_t kFrames = 16384;
+    static const size_t kBatch  = 64;
+    static const size_t kRun    = 16;
+
+    auto& falloc = machine.Boot(HostMachine::PcMemoryMap(mb * 1024), mb * 1024);
+    falloc.SetAllocPolicy(policy);
+    std::vector<void*> frames(kFrames);
+
+    /* Single frames, allocated in bulk then freed in allocation order. */
+    auto start = Clock::now();
+    for (size_t i = 0; i < kFrames; ++i)
+        frames[i] = falloc.AllocFrame();
+    double alloc_ns = ElapsedNs(start) / kFrames;
+    start = Clock::now();
+    for (size_t i = 0; i < kFrames; ++i)
+        falloc.FreeFrame(frames[i]);
+    double free_ns = ElapsedNs(start) / kFrames;
+
+    /* Batches of kBatch frames. */
+    start = Clock::now();
+    for (size_t i = 0; i < kFrames; i += kBatch)
+        falloc.AllocFrameBatch(&frames[i], kBatch);
+    double batch_alloc_ns = ElapsedNs(start) / kFrames;
+    start = Clock::now();
+    for (size_t i = 0; i < kFrames; i += kBatch)
+        falloc.FreeFrameBatch(&frames[i], kBatch);
+    double batch_free_ns = ElapsedNs(start) / kFrames;
+
+    /* Naturally aligned runs of kRun frames. */
+    size_t runs = kFrames / kRun;
+    start = Clock::now();
+    for (size_t i = 0; i < runs; ++i)
+        frames[i] = falloc.AllocFrames(kRun, kRun * PhysicalFrameAllocator::kFrameSize);
+    double run_alloc_ns = ElapsedNs(start) / runs;
+    start = Clock::now();
+    for (size_t i = 0; i < runs; ++i)
+        falloc.FreeFrames(frames[i], kRun);
+    double run_free_ns = ElapsedNs(start) / runs;
+
+    printf("%10zu %10s %10.1f %10.1f %12.1f %12.1f %12.1f %12.1f\n",
+           mb, PolicyName(policy), alloc_ns, free_ns, batch_alloc_ns,
+           batch_free_ns, run_alloc_ns, run_free_ns);
+}
+
+static void BenchFillLevels(HostMachine& machine, size_t mb, Policy policy)
+{
+    static const double kFill[] = { 0.0, 0.5, 0.9, 0.99, 0.999 };
+    static const size_t kReps   = 100000;
+
+    for (double fill : kFill) {
+        auto& falloc =
+            machine.Boot(HostMachine::PcMemoryMap(mb * 1024), mb * 1024);
+        falloc.SetAllocPolicy(policy);
+
+        /* Take every frame, then give back a random (1 - fill) share so
+           that the remaining free frames are scattered over memory. */
+        std::vector<void*> frames(falloc.GetMaxFrames());
+        size_t taken = falloc.AllocFrameBatch(frames.data(), frames.size(),
+                                              Zone::kHigh);
+        frames.resize(taken);
+
+        std::mt19937 rng(1);
+        std::shuffle(frames.begin(), frames.end(), rng);
+        size_t release = static_cast<size_t>(taken * (1.0 - fill));
+        if (!release)
+            release = 1;
+        falloc.FreeFrameBatch(frames.data(), release);
+
+        /* Allocate and immediately free a frame so the fill level stays
+           constant. Next fit moves its cursor past each hit. */
+        auto start = Clock::now();
+        for (size_t i = 0; i < kReps; ++i)
+            falloc.FreeFrame(falloc.AllocFrame(Zone::kHigh));
+        printf("%10zu %10s %9.1f%% %14.1f\n", mb, PolicyName(policy),
+               fill * 100.0, ElapsedNs(start) / kReps);
+    }
+}
+
+/*!
+ * \brief Compare single frame alloc/free through the PageMagazine with
+ *        direct PhysicalFrameAllocator calls.
+ *
+ * Each round allocates a burst of frames and frees it again, like a few
+ * page faults followed by an unmap. The frames' physical addresses are
+ * backed by a host buffer, so the touch columns include writing every frame
+ * once: frames that come back from the magazine are still in the host
+ * caches, the next fit cursor of the allocator keeps moving to cold ones.
+ */
+static void BenchMagazine(HostMachine& machine, size_t mb, size_t burst)
+{
+    static const size_t kRounds = 20000;
+
+    const uint32_t kFrameSize = PhysicalFrameAllocator::kFrameSize;
+    size_t         size       = mb << 20;
+    void*          memory     = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == memory) {
+        fprintf(stderr, "error, unable to map %zu MiB\n", mb);
+        exit(EXIT_FAILURE);
+    }
+    uint8_t* ram = static_cast<uint8_t*>(memory);
+    memset(ram, 0, size);
+
+    auto&    magazine = PageMagazine::GetInstance();
+    uint32_t hits     = magazine.GetHits();
+    uint32_t misses   = magazine.GetMisses();
+    std::vector<void*> frames(burst);
+    double ns[2][2];
+
+    for (int cached = 0; cached < 2; ++cached) {
+        for (int touch = 0; touch < 2; ++touch) {
+            auto& falloc =
+                machine.Boot(HostMachine::PcMemoryMap(mb * 1024), mb * 1024);
+            falloc.SetAllocPolicy(Policy::kNextFit);
+
+            auto start = Clock::now();
+            for (size_t round = 0; round < kRounds; ++round) {
+                for (size_t i = 0; i < burst; ++i) {
+                    void* frame = cached ? magazine.AllocFrame() :
+                                           falloc.AllocFrame();
+                    if (touch)
+                        memset(ram + reinterpret_cast<uintptr_t>(frame), 1,
+                               kFrameSize);
+                    frames[i] = frame;
+                }
+                for (size_t i = 0; i < burst; ++i) {
+                    if (cached)
+                        magazine.FreeFrame(frames[i]);
+                    else
+                        falloc.FreeFrame(frames[i]);
+                }
+            }
+            ns[cached][touch] = ElapsedNs(start) / (kRounds * burst);
+            magazine.Drain();
+        }
+    }
+
+    hits            = magazine.GetHits() - hits;
+    uint32_t total  = hits + magazine.GetMisses() - misses;
+    printf("%10zu %8zu %10.1f %10.1f %12.1f %12.1f %9.2f%%\n", mb, burst,
+           ns[0][0], ns[1][0], ns[0][1], ns[1][1],
+           total ? (100.0 * hits / total) : 0.0);
+    munmap(memory, size);
+}
+
+int main()
+{
+    HostMachine machine;
+
+    printf("PhysicalFrameAllocator host benchmarks (%s backend)\n", kBackend);
+    BenchInit(machine);
+
+    printf("\nAlloc/free throughput (ns per frame, ns per run of 16)\n");
+    printf("%10s %10s %10s %10s %12s %12s %12s %12s\n", "RAM (MiB)",
+           "policy", "alloc", "free", "batch alloc", "batch free",
+           "run alloc", "run free");
+    for (size_t mb : { 256, 3072 }) {
+        BenchThroughput(machine, mb, Policy::kFirstFit);
+        BenchThroughput(machine, mb, Policy::kNextFit);
+    }
+
+    printf("\nTime to first free frame vs. fill level (ns per alloc/free pair)\n");
+    printf("%10s %10s %10s %14s\n", "RAM (MiB)", "policy", "fill", "alloc+free");
+    for (size_t mb : { 1024 }) {
+        BenchFillLevels(machine, mb, Policy::kFirstFit);
+        BenchFillLevels(machine, mb, Policy::kNextFit);
+    }
+
+    printf("\nPageMagazine vs. direct alloc (ns per alloc/free pair, touch writes the frame)\n");
+    printf("%10s %8s %10s %10s %12s %12s %10s\n", "RAM (MiB)", "burst",
+           "direct", "magazine", "direct+touch", "magaz.+touch", "hit rate");
+    for (size_t burst : { 1, 8, 64 })
+        BenchMagazine(machine, 256, burst);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,926 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "FrameMagazine.h"
+#include "HostMachine.h"
+#include "PhysicalFrameAllocator.h"
+#include "SummaryBitmap.h"
+
+/*
+ * Randomized differential tests of the frame bitmap helpers, SummaryBitmap,
+ * PhysicalFrameAllocator and the PageMagazine in front of it. Every
+ * operation is mirrored on a byte per bit reference model and the results
+ * are compared. On a mismatch the seed is printed so the failure can be
+ * replayed with 'PfaFuzz <seed>'.
+ */
+
+using cosmo::test::BootModule;
+using cosmo::test::HostMachine;
+using cosmo::test::MemoryRegion;
+using cosmo::vmem::PageMagazine;
+using cosmo::vmem::PhysicalFrameAllocator;
+using cosmo::vmem::SummaryBitmap;
+
+using Zone   = PhysicalFrameAllocator::Zone;
+using Random = std::mt19937;
+
+#define CHECK(cond, ...)                                                   \
+    do {                                                                   \
+        if (!(cond)) {                                                     \
+            fprintf(stderr, "%s:%d: check '%s' failed: ", __FILE__,        \
+                    __LINE__, #cond);                                      \
+            fprintf(stderr, __VA_ARGS__);                                  \
+            fprintf(stderr, "\n");                                         \
+            return false;                                                  \
+        }                                                                  \
+    } while (0)
+
+#ifdef COSMO_PFA_BUDDY
+static const bool kBuddy = true;
+#else
+static const bool kBuddy = false;
+#endif
+
+static uint32_t Uniform(Random& rng, uint32_t lo, uint32_t hi)
+{
+    return std::uniform_int_distribution<uint32_t>(lo, hi)(rng);
+}
+
+static bool TestBitmapHelpers(Random& rng)
+{
+    for (int round = 0; round < 200; ++round) {
+        size_t nbits = Uniform(rng, 1, 2000);
+        std::vector<uint32_t> bitmap(SummaryBitmap::BitmapWords(nbits), 0);
+        std::vector<uint8_t>  ref(nbits, 0);
+
+        for (int op = 0; op < 200; ++op) {
+            uint32_t bit   = Uniform(rng, 0, nbits - 1);
+            uint32_t count = Uniform(rng, 0, nbits - bit);
+            switch (Uniform(rng, 0, 3)) {
+            case 0:
+                cosmo::vmem::BitmapSet(bitmap.data(), bit);
+                ref[bit] = 1;
+                break;
+            case 1:
+                cosmo::vmem::BitmapUnset(bitmap.data(), bit);
+                ref[bit] = 0;
+                break;
+            case 2:
+                cosmo::vmem::BitmapSetRange(bitmap.data(), bit, count);
+                std::fill(ref.begin() + bit, ref.begin() + bit + count, 1);
+                break;
+            default:
+                cosmo::vmem::BitmapUnsetRange(bitmap.data(), bit, count);
+                std::fill(ref.begin() + bit, ref.begin() + bit + count, 0);
+                break;
+            }
+
+            size_t set = std::count(ref.begin(), ref.end(), 1);
+            CHECK(cosmo::vmem::BitmapCountSet(bitmap.data(), nbits) == set,
+                  "nbits=%zu", nbits);
+
+            auto it    = std::find(ref.begin(), ref.end(), 0);
+            int  first = (it == ref.end()) ? -1 : (it - ref.begin());
+            CHECK(cosmo::vmem::BitmapFirstUnset(bitmap.data(), nbits) == first,
+                  "nbits=%zu expected %d", nbits, first);
+
+            uint32_t probe = Uniform(rng, 0, nbits - 1);
+            CHECK(!!cosmo::vmem::BitmapTest(bitmap.data(), probe) == !!ref[probe],
+                  "bit %u", probe);
+        }
+    }
+    return true;
+}
+
+static bool TestSummaryBitmap(Random& rng)
+{
+    static const size_t kSizes[] = { 0, 1, 31, 32, 33, 1023, 1024, 1025,
+                                     40000, 70000 };
+
+    for (size_t nbits : kSizes) {
+        size_t words = SummaryBitmap::BitmapWords(nbits);
+        std::vector<uint32_t> bitmap(words + 1, 0xFFFFFFFF);
+        std::vector<uint32_t> summary(SummaryBitmap::SummaryWords(nbits) + 1);
+        std::vector<uint8_t>  ref(nbits, 1);
+
+        SummaryBitmap sb;
+        sb.Init(bitmap.data(), summary.data(), nbits);
+        sb.Rebuild();
+        CHECK(sb.FirstUnset() == -1, "nbits=%zu not full", nbits);
+        if (!nbits)
+            continue;
+
+        for (int op = 0; op < 2000; ++op) {
+            uint32_t bit   = Uniform(rng, 0, nbits - 1);
+            uint32_t count = Uniform(rng, 0, std::min<size_t>(nbits - bit, 3000));
+            switch (Uniform(rng, 0, 3)) {
+            case 0:
+                if (!ref[bit]) {
+                    sb.Set(bit);
+                    ref[bit] = 1;
+                }
+                break;
+            case 1:
+                if (ref[bit]) {
+                    sb.Unset(bit);
+                    ref[bit] = 0;
+                }
+                break;
+            case 2:
+                sb.SetRange(bit, count);
+                std::fill(ref.begin() + bit, ref.begin() + bit + count, 1);
+                break;
+            default:
+                sb.UnsetRange(bit, count);
+                std::fill(ref.begin() + bit, ref.begin() + bit + count, 0);
+                break;
+            }
+
+            auto it    = std::find(ref.begin(), ref.end(), 0);
+            int  first = (it == ref.end()) ? -1 : (it - ref.begin());
+            CHECK(sb.FirstUnset() == first, "nbits=%zu expected %d got %d",
+                  nbits, first, sb.FirstUnset());
+
+            uint32_t from = Uniform(rng, 0, nbits - 1);
+            it            = std::find(ref.begin() + from, ref.end(), 0);
+            int next      = (it == ref.end()) ? -1 : (it - ref.begin());
+            CHECK(sb.NextUnset(from) == next, "nbits=%zu from=%u expected %d",
+                  nbits, from, next);
+
+            uint32_t max_len = Uniform(rng, 1, 5000);
+            uint32_t run     = 0;
+            while ((run < max_len) && (from + run < nbits) && !ref[from + run])
+                run++;
+            CHECK(sb.UnsetRunLength(from, max_len) == run,
+                  "nbits=%zu from=%u expected %u", nbits, from, run);
+        }
+    }
+    return true;
+}
+
+/*!
+ * \class FrameModel
+ * \brief Reference model of the frame allocator state.
+ */
+class FrameModel
+{
+public:
+    explicit FrameModel(size_t nframes) :
+        used_(nframes, 1),
+        refs_(nframes, 0)
+    {
+        const uint64_t kZoneEnds[PhysicalFrameAllocator::kNumZones] = {
+            PhysicalFrameAllocator::kDmaZoneEnd,
+            PhysicalFrameAllocator::kNormalZoneEnd,
+            PhysicalFrameAllocator::kHighZoneEnd,
+            UINT64_MAX
+        };
+
+        uint32_t start = 0;
+        for (int z = 0; z < PhysicalFrameAllocator::kNumZones; ++z) {
+            uint64_t end = kZoneEnds[z] / PhysicalFrameAllocator::kFrameSize;
+            end       = std::min<uint64_t>(end, nframes);
+            zones_[z] = std::make_pair(start, end);
+            start     = end;
+        }
+    }
+
+    size_t Size() const { return used_.size(); }
+    bool Used(uint32_t frame) const { return used_[frame]; }
+    uint16_t Refs(uint32_t frame) const { return refs_[frame]; }
+    void SetRefs(uint32_t frame, uint16_t refs) { refs_[frame] = refs; }
+
+    /*!
+     * \brief Mark frames as allocated (one reference) or free.
+     */
+    void Mark(uint32_t frame, size_t count, bool used)
+    {
+        std::fill(used_.begin() + frame, used_.begin() + frame + count, used);
+        std::fill(refs_.begin() + frame, refs_.begin() + frame + count, used);
+    }
+
+    /*!
+     * \brief Drop the references of every frame (reserved frames have none).
+     */
+    void ClearRefs() { std::fill(refs_.begin(), refs_.end(), 0); }
+
+    size_t UsedFrames() const
+        { return std::count(used_.begin(), used_.end(), 1); }
+
+    std::pair<uint32_t, uint32_t> ZoneRange(int z) const { return zones_[z]; }
+
+    int ZoneOf(uint32_t frame) const
+    {
+        int z = PhysicalFrameAllocator::kNumZones - 1;
+        while (z && (frame < zones_[z].first))
+            z--;
+        return z;
+    }
+
+    size_t ZoneFree(int z) const
+    {
+        return std::count(used_.begin() + zones_[z].first,
+                          used_.begin() + zones_[z].second, 0);
+    }
+
+    /*!
+     * \brief Return the first run of \a count free frames in zone \a z
+     *        starting at a multiple of \a step, or -1.
+     */
+    long FindRun(int z, uint32_t count, uint32_t step) const
+    {
+        uint64_t start = ((zones_[z].first + step - 1) / step) * step;
+        for (; start + count <= zones_[z].second; start += step) {
+            auto first = used_.begin() + start;
+            if (std::find(first, first + count, 1) == first + count)
+                return static_cast<long>(start);
+        }
+        return -1;
+    }
+
+private:
+    std::vector<uint8_t>          used_;
+    std::vector<uint16_t>         refs_;
+    std::pair<uint32_t, uint32_t> zones_[PhysicalFrameAllocator::kNumZones];
+}; // end FrameModel
+
+/*!
+ * \brief Build the expected post Init() state from the memory \a map.
+ */
+static bool InitModel(FrameModel& model, const std::vector<MemoryRegion>& map,
+                      const PhysicalFrameAllocator& falloc)
+{
+    const uint32_t kFrameSize = PhysicalFrameAllocator::kFrameSize;
+
+    for (const MemoryRegion& region : map) {
+        if (MULTIBOOT_MEMORY_AVAILABLE != region.type)
+            continue;
+        uint64_t start = (static_cast<uint64_t>(region.addr) + kFrameSize - 1) /
+                         kFrameSize;
+        uint64_t end   = (static_cast<uint64_t>(region.addr) + region.len) /
+                         kFrameSize;
+        end = std::min<uint64_t>(end, model.Size());
+        if (start < end)
+            model.Mark(start, end - start, false);
+    }
+    model.Mark(0, 1, true);
+    model.Mark(HostMachine::kKernelStart / kFrameSize,
+               (HostMachine::kKernelEnd - HostMachine::kKernelStart) / kFrameSize,
+               true);
+
+    /* The allocator metadata size is an implementation detail. It must be
+       a short run of frames directly after the kernel. */
+    size_t   used  = model.UsedFrames();
+    uint32_t frame = HostMachine::kKernelEnd / kFrameSize;
+    while (used < falloc.GetUsedFrames()) {
+        CHECK(frame < (HostMachine::kKernelEnd / kFrameSize) + 2048,
+              "metadata larger than 8 MiB");
+        if (!model.Used(frame)) {
+            model.Mark(frame, 1, true);
+            used++;
+        }
+        frame++;
+    }
+    CHECK(used == falloc.GetUsedFrames(), "expected %zu used frames, got %zu",
+          used, falloc.GetUsedFrames());
+    model.ClearRefs();
+    return true;
+}
+
+static bool CheckCounters(const FrameModel& model,
+                          PhysicalFrameAllocator& falloc)
+{
+    CHECK(model.UsedFrames() == falloc.GetUsedFrames(), "used %zu vs %zu",
+          model.UsedFrames(), falloc.GetUsedFrames());
+
+    for (int z = 0; z < PhysicalFrameAllocator::kNumZones; ++z) {
+        Zone zone = static_cast<Zone>(z);
+        auto range = model.ZoneRange(z);
+        CHECK(falloc.GetZoneFrames(zone) == range.second - range.first,
+              "zone %d size", z);
+        CHECK(falloc.GetZoneFreeFrames(zone) == model.ZoneFree(z),
+              "zone %d free %zu vs %zu", z, model.ZoneFree(z),
+              falloc.GetZoneFreeFrames(zone));
+    }
+
+    const size_t kChunk = PhysicalFrameAllocator::kFramesPerChunk;
+    for (size_t c = 0; c < falloc.GetNumChunks(); ++c) {
+        size_t free = 0;
+        for (size_t f = c * kChunk; f < std::min(model.Size(), (c + 1) * kChunk); ++f)
+            free += !model.Used(f);
+        CHECK(falloc.GetChunkFreeFrames(c) == free, "chunk %zu free %zu vs %u",
+              c, free, falloc.GetChunkFreeFrames(c));
+    }
+
+    for (uint32_t f = 0; f < model.Size(); ++f) {
+        const cosmo::vmem::FrameDescriptor* desc = falloc.GetDescriptor(
+            reinterpret_cast<void*>(static_cast<uintptr_t>(f) *
+                                    PhysicalFrameAllocator::kFrameSize));
+        CHECK(desc, "frame %u has no descriptor", f);
+        CHECK(desc->refcount == model.Refs(f), "frame %u refcount %u vs %u",
+              f, model.Refs(f), desc->refcount);
+        CHECK(desc->zone == model.ZoneOf(f), "frame %u zone", f);
+        CHECK(!!(desc->flags & cosmo::vmem::kFrameShared) == (model.Refs(f) > 1),
+              "frame %u shared flag", f);
+        if (!model.Used(f))
+            CHECK(!desc->flags, "free frame %u has flags %x", f, desc->flags);
+    }
+    return true;
+}
+
+/*!
+ * \brief Check a single frame allocated from \a zone against the model.
+ */
+static bool CheckAllocFrame(const FrameModel& model, Zone zone, void* frame,
+                            bool first_fit)
+{
+    int  pref     = static_cast<int>(zone);
+    long expected = -1;
+    for (int z = pref; (z >= 0) && (-1 == expected); --z)
+        expected = model.FindRun(z, 1, 1);
+
+    if (!frame) {
+        CHECK(-1 == expected, "zone %d returned nullptr, frame %ld is free",
+              pref, expected);
+        return true;
+    }
+
+    uint32_t index = reinterpret_cast<uintptr_t>(frame) /
+                     PhysicalFrameAllocator::kFrameSize;
+    CHECK(index < model.Size(), "frame %u out of range", index);
+    CHECK(!model.Used(index), "frame %u already in use", index);
+    CHECK(-1 != expected, "frame %u returned, model has none free", index);
+    CHECK(model.ZoneOf(index) == model.ZoneOf(expected),
+          "frame %u from zone %d, expected zone %d", index,
+          model.ZoneOf(index), model.ZoneOf(expected));
+    if (first_fit)
+        CHECK(static_cast<long>(index) == expected,
+              "first fit returned %u, expected %ld", index, expected);
+    return true;
+}
+
+struct LiveRun
+{
+    uint32_t frame;
+    uint32_t count;
+    bool     single;
+}; // end LiveRun
+
+/*!
+ * \brief Release the single frame \a frame through PutFrame().
+ */
+static bool PutAll(FrameModel& model, PhysicalFrameAllocator& falloc,
+                   uint32_t frame)
+{
+    void* addr = reinterpret_cast<void*>(static_cast<uintptr_t>(frame) *
+                                         PhysicalFrameAllocator::kFrameSize);
+    while (model.Refs(frame) > 1) {
+        CHECK(!falloc.PutFrame(addr), "frame %u freed with %u references",
+              frame, model.Refs(frame));
+        model.SetRefs(frame, model.Refs(frame) - 1);
+    }
+    CHECK(falloc.PutFrame(addr), "frame %u not freed by the last PutFrame()",
+          frame);
+    CHECK(!falloc.PutFrame(addr), "PutFrame() on free frame %u", frame);
+    model.Mark(frame, 1, false);
+    return true;
+}
+
+static bool TestAllocator(Random& rng, const char* name,
+                          const std::vector<MemoryRegion>& map, size_t mem_kb,
+                          PhysicalFrameAllocator::AllocPolicy policy)
+{
+    HostMachine machine;
+    auto& falloc = machine.Boot(map, mem_kb);
+    falloc.SetAllocPolicy(policy);
+
+    FrameModel model(falloc.GetMaxFrames());
+    if (!InitModel(model, map, falloc) || !CheckCounters(model, falloc)) {
+        fprintf(stderr, "  in %s after Init()\n", name);
+        return false;
+    }
+
+    bool first_fit = !kBuddy &&
+                     (PhysicalFrameAllocator::AllocPolicy::kFirstFit == policy);
+    std::vector<LiveRun> live;
+    std::vector<void*>   batch;
+
+    /* The model searches are linear, scale the op count with memory size. */
+    size_t ops = std::max<size_t>(2000, 400000000 / model.Size() / 8);
+    for (size_t op = 0; op < ops; ++op) {
+        Zone     zone = static_cast<Zone>(Uniform(rng, 0, 2));
+        uint32_t kind = Uniform(rng, 0, 11);
+
+        if (kind < 3) {
+            void* frame = falloc.AllocFrame(zone);
+            if (!CheckAllocFrame(model, zone, frame, first_fit))
+                goto fail;
+            if (frame) {
+                uint32_t index = reinterpret_cast<uintptr_t>(frame) /
+                                 PhysicalFrameAllocator::kFrameSize;
+                model.Mark(index, 1, true);
+                live.push_back({ index, 1, true });
+            }
+        } else if (kind < 4) {
+            batch.resize(Uniform(rng, 1, 4096));
+            size_t got = falloc.AllocFrameBatch(batch.data(), batch.size(), zone);
+            size_t avail = 0;
+            for (int z = static_cast<int>(zone); z >= 0; --z)
+                avail += model.ZoneFree(z);
+            if (got != std::min(avail, batch.size())) {
+                fprintf(stderr, "batch of %zu returned %zu, %zu available\n",
+                        batch.size(), got, avail);
+                goto fail;
+            }
+            for (size_t i = 0; i < got; ++i) {
+                uint32_t index = reinterpret_cast<uintptr_t>(batch[i]) /
+                                 PhysicalFrameAllocator::kFrameSize;
+                if ((index >= model.Size()) || model.Used(index)) {
+                    fprintf(stderr, "batch frame %u invalid\n", index);
+                    goto fail;
+                }
+                model.Mark(index, 1, true);
+                live.push_back({ index, 1, true });
+            }
+        } else if (kind < 6) {
+            uint32_t count = Uniform(rng, 0, 1) ? (1U << Uniform(rng, 0, 9)) :
+                                                  Uniform(rng, 1, 100);
+            uint32_t align = PhysicalFrameAllocator::kFrameSize <<
+                             Uniform(rng, 0, 14);
+            uint32_t step  = align / PhysicalFrameAllocator::kFrameSize;
+            void*    run   = falloc.AllocFrames(count, align, zone);
+
+            long expected = -1;
+            for (int z = static_cast<int>(zone); (z >= 0) && (-1 == expected); --z)
+                expected = model.FindRun(z, count, step);
+
+            if (!run) {
+                /* The buddy backend is limited by block order and splits,
+                   only the bitmap search is guaranteed to find a run. */
+                if (!kBuddy && (-1 != expected)) {
+                    fprintf(stderr, "missed run of %u (step %u) at %ld\n",
+                            count, step, expected);
+                    goto fail;
+                }
+                continue;
+            }
+
+            uint32_t index = reinterpret_cast<uintptr_t>(run) /
+                             PhysicalFrameAllocator::kFrameSize;
+            if ((index % step) || (index + count > model.Size()) ||
+                (model.ZoneOf(index) != model.ZoneOf(index + count - 1)) ||
+                (model.ZoneOf(index) > static_cast<int>(zone))) {
+                fprintf(stderr, "bad run %u count %u step %u zone %d\n",
+                        index, count, step, static_cast<int>(zone));
+                goto fail;
+            }
+            for (uint32_t i = 0; i < count; ++i) {
+                if (model.Used(index + i)) {
+                    fprintf(stderr, "run %u count %u overlaps frame %u\n",
+                            index, count, index + i);
+                    goto fail;
+                }
+            }
+            if (!kBuddy && (model.ZoneOf(index) != model.ZoneOf(expected))) {
+                fprintf(stderr, "run from zone %d, expected zone %d\n",
+                        model.ZoneOf(index), model.ZoneOf(expected));
+                goto fail;
+            }
+            model.Mark(index, count, true);
+            live.push_back({ index, count, false });
+        } else if ((kind >= 10) && !live.empty()) {
+            /* Share a single frame, or drop one of its extra references. */
+            const LiveRun& run = live[Uniform(rng, 0, live.size() - 1)];
+            void* addr = reinterpret_cast<void*>(
+                static_cast<uintptr_t>(run.frame) *
+                PhysicalFrameAllocator::kFrameSize);
+            if (!run.single)
+                continue;
+            if ((10 == kind) || (model.Refs(run.frame) == 1)) {
+                if (!falloc.GetFrame(addr)) {
+                    fprintf(stderr, "GetFrame(%u) failed\n", run.frame);
+                    goto fail;
+                }
+                model.SetRefs(run.frame, model.Refs(run.frame) + 1);
+            } else {
+                if (falloc.PutFrame(addr)) {
+                    fprintf(stderr, "PutFrame(%u) freed a shared frame\n",
+                            run.frame);
+                    goto fail;
+                }
+                model.SetRefs(run.frame, model.Refs(run.frame) - 1);
+            }
+        } else if (!live.empty()) {
+            /* Free a random handful of live allocations. Shared frames are
+               released one reference at a time. */
+            size_t nfree = Uniform(rng, 1, std::min<size_t>(live.size(), 64));
+            batch.clear();
+            for (size_t i = 0; i < nfree; ++i) {
+                size_t  k   = Uniform(rng, 0, live.size() - 1);
+                LiveRun run = live[k];
+                live[k]     = live.back();
+                live.pop_back();
+
+                void* addr = reinterpret_cast<void*>(
+                    static_cast<uintptr_t>(run.frame) *
+                    PhysicalFrameAllocator::kFrameSize);
+                if (run.single && (model.Refs(run.frame) > 1)) {
+                    if (!PutAll(model, falloc, run.frame))
+                        goto fail;
+                    continue;
+                }
+                if (run.single && (kind == 9))
+                    batch.push_back(addr);
+                else if (run.single && Uniform(rng, 0, 1))
+                    falloc.FreeFrame(addr);
+                else
+                    falloc.FreeFrames(addr, run.count);
+                model.Mark(run.frame, run.count, false);
+            }
+            falloc.FreeFrameBatch(batch.data(), batch.size());
+        }
+
+        if (!(op % 64) && !CheckCounters(model, falloc))
+            goto fail;
+    }
+
+    for (const LiveRun& run : live) {
+        falloc.FreeFrames(reinterpret_cast<void*>(
+                              static_cast<uintptr_t>(run.frame) *
+                              PhysicalFrameAllocator::kFrameSize),
+                          run.count);
+        model.Mark(run.frame, run.count, false);
+    }
+    if (!CheckCounters(model, falloc))
+        goto fail;
+    return true;
+
+fail:
+    fprintf(stderr, "  in %s (%s)\n", name,
+            (PhysicalFrameAllocator::AllocPolicy::kFirstFit == policy) ?
+                "first fit" : "next fit");
+    return false;
+}
+
+/*!
+ * \brief Run random alloc/free/put sequences through the PageMagazine.
+ *
+ * The magazine is mirrored by a stack of frame indices. Frames moved in by a
+ * refill are not known until they are handed out and are mirrored as -1.
+ * Cached frames must stay allocated in the PhysicalFrameAllocator without a
+ * reference, so that its GetFrame() and PutFrame() reject them.
+ */
+static bool TestMagazine(Random& rng, const char* name,
+                         const std::vector<MemoryRegion>& map, size_t mem_kb,
+                         PhysicalFrameAllocator::AllocPolicy policy)
+{
+    const uint32_t kFrameSize = PhysicalFrameAllocator::kFrameSize;
+    const size_t   kDepth     = 2 * PageMagazine::kBatch;
+
+    HostMachine machine;
+    auto& falloc   = machine.Boot(map, mem_kb);
+    auto& magazine = PageMagazine::GetInstance();
+    falloc.SetAllocPolicy(policy);
+
+    FrameModel model(falloc.GetMaxFrames());
+    if (!InitModel(model, map, falloc))
+        return false;
+
+    size_t                base_used = falloc.GetUsedFrames();
+    uint32_t              hits      = magazine.GetHits();
+    uint32_t              misses    = magazine.GetMisses();
+    std::vector<long>     cache;
+    std::vector<uint32_t> held;
+    std::vector<uint16_t> refs(model.Size(), 0);
+
+    auto addr = [kFrameSize](uint32_t frame) {
+        return reinterpret_cast<void*>(static_cast<uintptr_t>(frame) * kFrameSize);
+    };
+    auto cacheable = [kFrameSize](uint32_t frame) {
+        uint64_t phys = static_cast<uint64_t>(frame) * kFrameSize;
+        return (phys >= PhysicalFrameAllocator::kDmaZoneEnd) &&
+               (phys < PhysicalFrameAllocator::kNormalZoneEnd);
+    };
+
+    for (int op = 0; op < 20000; ++op) {
+        uint32_t kind = Uniform(rng, 0, 9);
+
+        if ((kind < 4) || held.empty()) {
+            bool  empty = cache.empty();
+            void* frame = magazine.AllocFrame();
+            if (empty) {
+                misses++;
+                /* The refill moved count + 1 frames into the magazine. */
+                if (frame)
+                    cache.assign(magazine.GetCount() + 1, -1);
+            } else {
+                hits++;
+                CHECK(frame, "hit returned nullptr");
+            }
+            if (!frame) {
+                CHECK(!magazine.GetCount() &&
+                      (falloc.GetUsedFrames() == falloc.GetMaxFrames()),
+                      "nullptr with free frames left");
+                continue;
+            }
+
+            uint32_t index = reinterpret_cast<uintptr_t>(frame) / kFrameSize;
+            long     top   = cache.back();
+            cache.pop_back();
+            CHECK((-1 == top) || (index == top), "popped %u, expected %ld",
+                  index, top);
+            CHECK((index < model.Size()) && !model.Used(index) && !refs[index],
+                  "frame %u handed out twice", index);
+            CHECK(falloc.GetDescriptor(frame)->refcount == 1,
+                  "frame %u refcount %u", index,
+                  falloc.GetDescriptor(frame)->refcount);
+            refs[index] = 1;
+            held.push_back(index);
+        } else if (kind < 6) {
+            /* Share a held frame. */
+            uint32_t index = held[Uniform(rng, 0, held.size() - 1)];
+            CHECK(falloc.GetFrame(addr(index)), "GetFrame(%u) failed", index);
+            refs[index]++;
+        } else {
+            size_t   k     = Uniform(rng, 0, held.size() - 1);
+            uint32_t index = held[k];
+            size_t   count = magazine.GetCount();
+
+            if ((kind < 8) && (1 == refs[index])) {
+                magazine.FreeFrame(addr(index));
+            } else {
+                bool freed = magazine.PutFrame(
+                    static_cast<cosmo::vmem::PhysAddr>(index) * kFrameSize);
+                CHECK(freed == (1 == refs[index]), "PutFrame(%u) with %u refs",
+                      index, refs[index]);
+                if (--refs[index])
+                    continue;
+                if (!cacheable(index)) {
+                    /* Released straight to the allocator. */
+                    CHECK(magazine.GetCount() == count, "frame %u cached",
+                          index);
+                    held[k] = held.back();
+                    held.pop_back();
+                    continue;
+                }
+            }
+
+            /* A full magazine releases its oldest half first. */
+            if (kDepth == count)
+                cache.erase(cache.begin(), cache.begin() + PageMagazine::kBatch);
+            cache.push_back(index);
+            refs[index] = 0;
+            held[k]     = held.back();
+            held.pop_back();
+        }
+
+        CHECK(magazine.GetCount() == cache.size(), "magazine holds %zu, expected %zu",
+              magazine.GetCount(), cache.size());
+        CHECK((magazine.GetHits() == hits) && (magazine.GetMisses() == misses),
+              "hits %u misses %u, expected %u and %u", magazine.GetHits(),
+              magazine.GetMisses(), hits, misses);
+        CHECK(falloc.GetUsedFrames() == base_used + held.size() + cache.size(),
+              "%zu used frames, expected %zu", falloc.GetUsedFrames(),
+              base_used + held.size() + cache.size());
+
+        /* Cached frames are not reachable through their descriptor. */
+        for (long frame : cache) {
+            if (-1 == frame)
+                continue;
+            void* cached = addr(frame);
+            CHECK(!falloc.GetDescriptor(cached)->refcount,
+                  "cached frame %ld has references", frame);
+            CHECK(!falloc.GetFrame(cached) && !falloc.PutFrame(cached) &&
+                  !magazine.PutFrame(static_cast<cosmo::vmem::PhysAddr>(frame) *
+                                     kFrameSize),
+                  "cached frame %ld released", frame);
+        }
+    }
+
+    magazine.Drain();
+    CHECK(!magazine.GetCount(), "%zu frames left after Drain()",
+          magazine.GetCount());
+    for (uint32_t index : held) {
+        while (refs[index]--)
+            falloc.PutFrame(addr(index));
+    }
+    if (!CheckCounters(model, falloc)) {
+        fprintf(stderr, "  in %s magazine (%s)\n", name,
+                (PhysicalFrameAllocator::AllocPolicy::kFirstFit == policy) ?
+                    "first fit" : "next fit");
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * \brief Check that Multiboot modules, their list and their command lines
+ *        are never handed out.
+ */
+static bool TestModules(Random& rng)
+{
+    const uint32_t kFrameSize = PhysicalFrameAllocator::kFrameSize;
+    const size_t   kMemKb     = 32 * 1024;
+
+    /* Two modules at random, not necessarily page aligned, places between
+       12 MiB and 30 MiB. Only one has a command line. */
+    uint32_t first_start  = Uniform(rng, 12 << 20, 14 << 20);
+    uint32_t first_end    = first_start + Uniform(rng, 1, 2 << 20);
+    uint32_t second_start = Uniform(rng, 20 << 20, 28 << 20);
+    uint32_t second_end   = second_start + Uniform(rng, 1, 2 << 20);
+    std::vector<BootModule> modules = {
+        { first_start,  first_end,  "initrd" },
+        { second_start, second_end, nullptr }
+    };
+
+    /* Frames expected to stay in use, on top of a boot without modules. */
+    std::vector<std::pair<uint32_t, uint32_t>> reserved = {
+        { first_start / kFrameSize, (first_end + kFrameSize - 1) / kFrameSize },
+        { second_start / kFrameSize, (second_end + kFrameSize - 1) / kFrameSize },
+        { (HostMachine::kKernelEnd + HostMachine::kModsOffset) / kFrameSize,
+          (HostMachine::kKernelEnd + HostMachine::kModsOffset) / kFrameSize + 1 }
+    };
+    size_t extra = 0;
+    for (const auto& range : reserved)
+        extra += range.second - range.first;
+
+    HostMachine machine;
+    auto   map  = HostMachine::PcMemoryMap(kMemKb);
+    size_t used = machine.Boot(map, kMemKb).GetUsedFrames();
+    auto&  falloc = machine.Boot(map, kMemKb, modules);
+    CHECK(falloc.GetUsedFrames() == used + extra,
+          "modules: %zu used frames, expected %zu", falloc.GetUsedFrames(),
+          used + extra);
+
+    for (const auto& range : reserved) {
+        for (uint32_t f = range.first; f < range.second; ++f) {
+            auto* desc = falloc.GetDescriptor(
+                reinterpret_cast<void*>(static_cast<uintptr_t>(f) * kFrameSize));
+            CHECK(desc && (desc->flags & cosmo::vmem::kFrameReserved),
+                  "module frame %u not reserved", f);
+        }
+    }
+
+    std::vector<void*> frames(falloc.GetMaxFrames());
+    size_t taken = falloc.AllocFrameBatch(frames.data(), frames.size(),
+                                          Zone::kHigh);
+    for (size_t i = 0; i < taken; ++i) {
+        uint32_t f = reinterpret_cast<uintptr_t>(frames[i]) / kFrameSize;
+        for (const auto& range : reserved) {
+            CHECK((f < range.first) || (f >= range.second),
+                  "module frame %u handed out", f);
+        }
+    }
+    return true;
+}
+
+/*!
+ * \brief Return a memory map of \a mem_kb KB with random reserved holes.
+ *
+ * Region boundaries are not frame aligned so that partial frames at the
+ * edges of available regions are exercised.
+ */
+static std::vector<MemoryRegion> RandomMemoryMap(Random& rng, size_t mem_kb)
+{
+    std::vector<MemoryRegion> map;
+    uint64_t end  = static_cast<uint64_t>(mem_kb) * 1024;
+    uint64_t addr = 0;
+    bool     avail = true;
+    while (addr < end) {
+        uint64_t len = avail ? Uniform(rng, 0x1000, 0x4000000) :
+                               Uniform(rng, 0x100, 0x200000);
+        len = std::min(len, end - addr);
+        map.push_back({ static_cast<uint32_t>(addr), static_cast<uint32_t>(len),
+                        avail ? static_cast<uint32_t>(MULTIBOOT_MEMORY_AVAILABLE) :
+                                static_cast<uint32_t>(MULTIBOOT_MEMORY_RESERVED) });
+        addr  += len;
+        avail  = !avail;
+    }
+    return map;
+}
+
+/*!
+ * \brief Boot a machine with 1 GiB of memory above the 4 GiB line.
+ *
+ * PAE builds must put that memory in Zone::kPae and hand it out through
+ * AllocPhysFrame() only. Other builds must ignore it.
+ */
+static bool TestHighMemory()
+{
+    using cosmo::vmem::PhysAddr;
+
+    const uint64_t kFourGiB = PhysicalFrameAllocator::kHighZoneEnd;
+    std::vector<MemoryRegion> map = HostMachine::PcMemoryMap(512 * 1024);
+    map.push_back({0x20000000, kFourGiB - 0x20000000, MULTIBOOT_MEMORY_RESERVED});
+    map.push_back({kFourGiB, 1ULL << 30, MULTIBOOT_MEMORY_AVAILABLE});
+
+    HostMachine machine;
+    machine.Boot(map, 512 * 1024);
+    size_t mem_kb = machine.GetMemorySize();
+    auto&  falloc = machine.Boot(map, mem_kb);
+    size_t used   = falloc.GetUsedFrames();
+
+#ifdef COSMO_PAE
+    const size_t kHighFrames = (1 << 30) / PhysicalFrameAllocator::kFrameSize;
+    CHECK(mem_kb == (kFourGiB + (1ULL << 30)) / 1024, "memory size %zu KB",
+          mem_kb);
+#else
+    const size_t kHighFrames = 0;
+    CHECK(mem_kb == kFourGiB / 1024, "memory size %zu KB", mem_kb);
+#endif
+    CHECK(falloc.GetZoneFrames(Zone::kPae) == kHighFrames, "%zu PAE frames",
+          falloc.GetZoneFrames(Zone::kPae));
+    CHECK(falloc.GetZoneFreeFrames(Zone::kPae) == kHighFrames,
+          "%zu free PAE frames", falloc.GetZoneFreeFrames(Zone::kPae));
+    CHECK(!falloc.GetZoneFreeFrames(Zone::kHigh), "hole not reserved");
+
+    /* The pointer based calls never reach past 4 GiB. */
+    void* low = falloc.AllocFrame(Zone::kPae);
+    CHECK(low && (reinterpret_cast<uintptr_t>(low) < 0x20000000),
+          "AllocFrame() returned %p", low);
+    falloc.FreeFrame(low);
+
+    std::vector<PhysAddr> frames;
+    for (size_t i = 0; i < kHighFrames; ++i) {
+        PhysAddr frame = falloc.AllocPhysFrame();
+        CHECK((frame >= kFourGiB) && !(frame % PhysicalFrameAllocator::kFrameSize),
+              "AllocPhysFrame() returned %llx",
+              static_cast<unsigned long long>(frame));
+        frames.push_back(frame);
+    }
+    std::sort(frames.begin(), frames.end());
+    CHECK(std::adjacent_find(frames.begin(), frames.end()) == frames.end(),
+          "frame handed out twice");
+    CHECK(!falloc.GetZoneFreeFrames(Zone::kPae), "PAE zone not exhausted");
+
+    /* With the PAE zone exhausted the allocation falls back to low memory. */
+    PhysAddr fallback = falloc.AllocPhysFrame();
+    CHECK(fallback && (fallback < 0x20000000), "fallback frame %llx",
+          static_cast<unsigned long long>(fallback));
+    falloc.FreeFrame(fallback);
+
+    if (!frames.empty()) {
+        PhysAddr shared = frames.back();
+        CHECK(falloc.GetFrame(shared) &&
+              (falloc.GetDescriptor(shared)->refcount == 2),
+              "GetFrame() above 4 GiB");
+        CHECK(!falloc.PutFrame(shared) && falloc.PutFrame(shared),
+              "PutFrame() above 4 GiB");
+        frames.pop_back();
+    }
+    for (PhysAddr frame : frames)
+        falloc.FreeFrame(frame);
+
+    CHECK(falloc.GetZoneFreeFrames(Zone::kPae) == kHighFrames,
+          "%zu free PAE frames after free", falloc.GetZoneFreeFrames(Zone::kPae));
+    CHECK(falloc.GetUsedFrames() == used, "%zu used frames, expected %zu",
+          falloc.GetUsedFrames(), used);
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t seed   = (argc > 1) ? strtoul(argv[1], nullptr, 0) : 1;
+    int      rounds = (argc > 2) ? atoi(argv[2]) : 2;
+
+    for (int round = 0; round < rounds; ++round, ++seed) {
+        Random rng(seed);
+        printf("seed %u (%s backend)\n", seed, kBuddy ? "buddy" : "bitmap");
+
+        bool ok = TestBitmapHelpers(rng) && TestSummaryBitmap(rng) &&
+                  TestModules(rng) && TestHighMemory();
+        for (auto policy : { PhysicalFrameAllocator::AllocPolicy::kFirstFit,
+                             PhysicalFrameAllocator::AllocPolicy::kNextFit }) {
+            ok = ok &&
+                 TestAllocator(rng, "32 MiB PC map",
+                               HostMachine::PcMemoryMap(32 * 1024), 32 * 1024,
+                               policy) &&
+                 TestAllocator(rng, "15 MiB PC map",
+                               HostMachine::PcMemoryMap(15 * 1024), 15 * 1024,
+                               policy) &&
+                 TestAllocator(rng, "1 GiB random map",
+                               RandomMemoryMap(rng, 1024 * 1024), 1024 * 1024,
+                               policy) &&
+                 TestMagazine(rng, "32 MiB PC map",
+                              HostMachine::PcMemoryMap(32 * 1024), 32 * 1024,
+                              policy) &&
+                 TestMagazine(rng, "15 MiB PC map",
+                              HostMachine::PcMemoryMap(15 * 1024), 15 * 1024,
+                              policy);
+        }
+
+        if (!ok) {
+            fprintf(stderr, "FAILED, replay with: %s %u 1\n", argv[0], seed);
+            return EXIT_FAILURE;
+        }
+    }
+    printf("all tests passed\n");
+    return EXIT_SUCCESS;
+}